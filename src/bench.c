@@ -0,0 +1,75 @@
+#include "rbtree.h"
+#include "rbtree_td.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// 현재 시각을 초 단위로 리턴
+// parameters : void
+// return : double
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// parent 포인터가 있는 rbtree와 top-down rbtree에 같은 key를 넣고 지워서 연산당 시간을 비교
+// 할당기 차이가 섞이지 않도록 두 트리 모두 n개짜리 노드 블록을 미리 잡고 free list로 씀
+// parameters : size_t n
+// return : void
+static void bench(const size_t n) {
+  key_t *keys = (key_t *)malloc(n * sizeof(key_t));
+  rbtree *t = new_rbtree();
+  td_rbtree *td = new_rbtree_td();
+  double t0, t1, t2, t3, t4;
+
+  for(size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+  rbtree_reserve(t, n);
+  rbtree_td_reserve(td, n);
+
+  t0 = now();
+  for(size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  t1 = now();
+  for(size_t i = 0; i < n; i++) {
+    rbtree_erase(t, rbtree_find(t, keys[i]));
+  }
+  t2 = now();
+  for(size_t i = 0; i < n; i++) {
+    rbtree_td_insert(td, keys[i]);
+  }
+  t3 = now();
+  for(size_t i = 0; i < n; i++) {
+    rbtree_td_erase(td, keys[i]);
+  }
+  t4 = now();
+
+  printf("n=%zu\n", n);
+  printf("  %-8s insert %6.1f ns/op  erase %6.1f ns/op\n", "rbtree", (t1 - t0) * 1e9 / n,
+         (t2 - t1) * 1e9 / n);
+  printf("  %-8s insert %6.1f ns/op  erase %6.1f ns/op\n", "td", (t3 - t2) * 1e9 / n,
+         (t4 - t3) * 1e9 / n);
+
+  delete_rbtree_td(td);
+  delete_rbtree(t);
+  free(keys);
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+  // 노드 크기는 할당기와 무관하게 구조체 크기로 따로 보고
+  printf("node size: rbtree %zu bytes, td %zu bytes\n", sizeof(node_t), sizeof(td_node_t));
+  srand(1);
+  for(size_t m = 1000; m < n; m *= 10) {
+    bench(m);
+  }
+  bench(n);
+
+  return 0;
+}
@@ -1,36 +1,385 @@
 #include "rbtree.h"
+#include "rbtree_wal.h"
 
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// 노드를 연속된 메모리에 모아 두는 slab
+// compaction과 bulk load가 만들며, 가장 최근 slab(ext의 slabs)의 빈 칸은 삽입에 재사용
+// 해제된 칸은 parent를 NULL로 표시하고 left로 free list를 이룸
+struct rbtree_slab {
+  struct rbtree_slab *next;
+  node_t *nodes;
+  size_t cap, used, live, bytes;
+  node_t *free;
+};
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+// cap개의 노드를 담는 slab을 mmap으로 할당
+// 충분히 크면 transparent huge page를 요청하여 TLB miss를 줄임
+// parameters : size_t cap
+// return : rbtree_slab s, 실패 시 NULL
+static struct rbtree_slab *slab_new(size_t cap) {
+  struct rbtree_slab *s = (struct rbtree_slab *)calloc(1, sizeof(struct rbtree_slab));
+
+  if(s == NULL) {
+    return NULL;
+  }
+  s->cap = cap > 0 ? cap : 1;
+  s->bytes = s->cap * sizeof(node_t);
+  s->nodes = (node_t *)mmap(NULL, s->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(s->nodes == MAP_FAILED) {
+    free(s);
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  if(s->bytes >= HUGE_PAGE_SIZE) {
+    madvise(s->nodes, s->bytes, MADV_HUGEPAGE);
+  }
+#endif
+
+  return s;
+}
+
+static void slab_free(struct rbtree_slab *s) {
+  munmap(s->nodes, s->bytes);
+  free(s);
+}
+
+// 선택적인 mode(slab, relaxed, bounded)의 상태
+// 처음 쓰일 때 할당하므로 이런 mode를 쓰지 않는 트리는 포인터 하나만 차지
+struct rbtree_ext {
+  struct rbtree_slab *slabs;       // slab list, newest first
+  struct rbtree_slab *compacting;  // target slab of an unfinished compaction
+  size_t scan;                     // next slot of compacting to visit
+  int relaxed;                     // defer insert fixups, see rbtree_set_relaxed
+  size_t relax_budget;             // fixup steps run per insert in relaxed mode
+  node_t **pending;                // FIFO ring of red nodes whose parent may be red
+  size_t pending_head, npending, pending_cap;
+  size_t cap;                      // max number of nodes, 0 when unbounded
+  evict_t policy;                  // victim once size reaches cap
+  key_t *ring;                     // keys in insertion order, RBTREE_EVICT_OLDEST only
+  size_t ring_head;                // index of the oldest key in ring
+};
+
+// rbtree t의 ext를 리턴, 아직 없으면 할당
+// parameters : rbtree t
+// return : rbtree_ext e, 실패 시 NULL
+static struct rbtree_ext *ext_of(rbtree *t) {
+  if(t->ext == NULL) {
+    t->ext = (struct rbtree_ext *)calloc(1, sizeof(struct rbtree_ext));
+  }
+  return t->ext;
+}
+
+// 작은 트리의 노드 16개와 정렬된 key 배열을 함께 담는 block, 빈 트리의 첫 삽입 때 할당
+// 노드는 고정된 slot에 있으므로 promotion/demotion 후에도 node_t 포인터가 유효함
+// size가 RBTREE_SMALL_MAX 이하이고 모든 노드가 slot에 있는 동안(indexed)
+// find는 트리 대신 keys를 선형으로 훑고, 넘어서면 index를 버리고 트리만 씀(promotion)
+// 줄어들어 다시 조건을 만족하면 트리의 중위 순서로 index를 다시 채움(demotion)
+#define RBTREE_SMALL_MAX 16
+
+struct rbtree_small {
+  node_t nodes[RBTREE_SMALL_MAX];
+  key_t keys[RBTREE_SMALL_MAX];          // sorted, padded with INT_MAX
+  unsigned char slot[RBTREE_SMALL_MAX];  // keys[i] belongs to nodes[slot[i]]
+  unsigned used;                         // bitmask of slots in use
+  int indexed;                           // keys/slot mirror the tree
+};
+
+// 노드 p의 slot 번호
+// parameters : rbtree t, node_t p
+// return : slot 번호, small block 밖의 노드면 -1
+static int small_slot(const rbtree *t, const node_t *p) {
+  if(t->small == NULL || p < t->small->nodes || p >= t->small->nodes + RBTREE_SMALL_MAX) {
+    return -1;
+  }
+  return (int)(p - t->small->nodes);
+}
+
+// small block의 빈 slot 하나를 리턴, 빈 트리면 block을 먼저 할당
+// parameters : rbtree t
+// return : node_t p, 빈 slot이 없거나 할당 실패 시 NULL
+static node_t *small_alloc(rbtree *t) {
+  struct rbtree_small *s = t->small;
+  int i;
+
+  if(s == NULL) {
+    if(t->size > 0) {
+      return NULL;
+    }
+    s = (struct rbtree_small *)malloc(sizeof(struct rbtree_small));
+    if(s == NULL) {
+      return NULL;
+    }
+    for(i = 0; i < RBTREE_SMALL_MAX; i++) {
+      s->keys[i] = INT_MAX;
+    }
+    s->used = 0;
+    s->indexed = 1;
+    t->small = s;
+  }
+  if(s->used == (1u << RBTREE_SMALL_MAX) - 1) {
+    return NULL;
+  }
+  i = __builtin_ctz(~s->used);
+  s->used |= 1u << i;
+
+  return &s->nodes[i];
+}
+
+// key_t key 이하인 key의 개수 (같은 key는 뒤에 들어가도록)
+// 고정 길이의 분기 없는 반복이라 컴파일러가 SIMD로 바꿀 수 있음
+static size_t small_upper(const struct rbtree_small *s, const key_t key) {
+  size_t pos = 0;
+
+  for(int i = 0; i < RBTREE_SMALL_MAX; i++) {
+    pos += s->keys[i] <= key;
+  }
+  return pos;
+}
+
+// 트리에 막 연결된 노드 p를 index에 추가 (t->size는 아직 p를 세지 않음)
+// p가 slot 밖에 있거나 자리가 없으면 index를 버림(promotion)
+// parameters : rbtree t, node_t p
+// return : void
+static void small_add(rbtree *t, node_t *p) {
+  struct rbtree_small *s = t->small;
+  int i = small_slot(t, p);
+  size_t pos;
+
+  if(s == NULL || !s->indexed) {
+    return;
+  }
+  if(i < 0 || t->size >= RBTREE_SMALL_MAX) {
+    s->indexed = 0;
+    return;
+  }
+  pos = small_upper(s, p->key);
+  if(pos > t->size) {
+    pos = t->size;
+  }
+  memmove(&s->keys[pos + 1], &s->keys[pos], (t->size - pos) * sizeof(key_t));
+  memmove(&s->slot[pos + 1], &s->slot[pos], t->size - pos);
+  s->keys[pos] = p->key;
+  s->slot[pos] = (unsigned char)i;
+}
+
+// 트리에서 떼어낸 노드 p를 index에서 빼거나, 남은 노드가 모두 slot에 있으면 index를 다시 채움
+// t->size는 이미 p를 빼고 센 값
+// parameters : rbtree t, node_t p
+// return : void
+static void small_remove(rbtree *t, node_t *p) {
+  struct rbtree_small *s = t->small;
+  size_t i = 0;
+
+  if(s == NULL) {
+    return;
+  }
+  if(s->indexed) {
+    while(s->slot[i] != p - s->nodes) {
+      i++;
+    }
+    memmove(&s->keys[i], &s->keys[i + 1], (t->size - i) * sizeof(key_t));
+    memmove(&s->slot[i], &s->slot[i + 1], t->size - i);
+    s->keys[t->size] = INT_MAX;
+    return;
+  }
+  if((size_t)__builtin_popcount(s->used) - (small_slot(t, p) >= 0) != t->size) {
+    return;
+  }
+  for(node_t *x = t->leftmost; x != t->nil; i++) {
+    s->keys[i] = x->key;
+    s->slot[i] = (unsigned char)(x - s->nodes);
+    if(x->right != t->nil) {
+      x = x->right;
+      while(x->left != t->nil) {
+        x = x->left;
+      }
+    } else {
+      node_t *y = x->parent;
+      while(y != t->nil && x == y->right) {
+        x = y;
+        y = y->parent;
+      }
+      x = y;
+    }
+  }
+  for(; i < RBTREE_SMALL_MAX; i++) {
+    s->keys[i] = INT_MAX;
+  }
+  s->indexed = 1;
+}
+
+// 노드 p가 들어 있는 slab을 반환
+// parameters : rbtree t, node_t p
+// return : rbtree_slab s, 개별 할당된 노드면 NULL
+static struct rbtree_slab *slab_of(const rbtree *t, const node_t *p) {
+  if(t->ext == NULL) {
+    return NULL;
+  }
+  for(struct rbtree_slab *s = t->ext->slabs; s != NULL; s = s->next) {
+    if(p >= s->nodes && p < s->nodes + s->cap) {
+      return s;
+    }
+  }
+  return NULL;
+}
+
+// 노드 p가 개별 malloc이 아닌 small block 또는 slab에 있는지 확인 (해제 시 free하면 안 됨)
+static int in_arena(const rbtree *t, const node_t *p) {
+  return small_slot(t, p) >= 0 || slab_of(t, p) != NULL;
+}
+
+// 새 노드 하나를 할당
+// small block의 slot, 최근 slab의 빈 칸, malloc 순서로 시도
+// parameters : rbtree t
+// return : node_t p
+static node_t *node_alloc(rbtree *t) {
+  struct rbtree_slab *s = t->ext != NULL ? t->ext->slabs : NULL;
+  node_t *p = small_alloc(t);
+
+  if(p != NULL) {
+    return p;
+  }
+  if(s != NULL && s->free != NULL) {
+    p = s->free;
+    s->free = p->left;
+    s->live++;
+    return p;
+  }
+  return (node_t *)malloc(sizeof(node_t));
+}
+
+// 살아 있는 노드가 없는 slab s를 t의 slab list에서 빼고 해제
+// parameters : rbtree t, rbtree_slab s
+// return : void
+static void slab_release(rbtree *t, struct rbtree_slab *s) {
+  struct rbtree_slab **link = &t->ext->slabs;
+
+  while(*link != s) {
+    link = &(*link)->next;
+  }
+  *link = s->next;
+  slab_free(s);
+}
+
+// 노드 p를 반환, slab 노드면 free list에 넣고 살아 있는 노드가 없는 slab은 최근 slab이라도 해제
+// 트리가 비면 small block도 해제
+// parameters : rbtree t, node_t p
+// return : void
+static void node_free(rbtree *t, node_t *p) {
+  struct rbtree_slab *s;
+  int i = small_slot(t, p);
+
+  if(i >= 0) {
+    t->small->used &= ~(1u << i);
+    if(t->size == 0) {
+      free(t->small);
+      t->small = NULL;
+    }
+    return;
+  }
+  s = slab_of(t, p);
+  if(s == NULL) {
+    free(p);
+    return;
+  }
+
+  s->live--;
+  if(s->live > 0 || s == t->ext->compacting) {
+    if(s == t->ext->slabs || s == t->ext->compacting) {
+      p->parent = NULL;
+      p->left = s->free;
+      s->free = p;
+    }
+  } else {
+    slab_release(t, s);
+  }
+}
+
+// 모든 rbtree가 함께 쓰는 nil 노드
+// 여러 스레드의 서로 다른 트리가 동시에 쓸 수 있도록 어떤 연산도 nil에 쓰지 않음
+static node_t rbtree_nil = {RBTREE_BLACK, 0, NULL, NULL, NULL};
 
 // rb_tree 구조체 p를 할당하여 초기화 후 리턴
+// nil은 공유하고 small block과 선택적인 mode의 상태는 필요할 때 할당하므로 구조체 하나뿐
 // parameters : void
 // return : rbtree p
 rbtree *new_rbtree(void) {
   rbtree *p = (rbtree *)calloc(1, sizeof(rbtree));
 
   if (p != NULL) {
-    node_t *nil = (node_t *)calloc(1, sizeof(node_t));
-    if(nil != NULL) {
-      nil->color = RBTREE_BLACK;
-      p->nil = nil;
-      p->root = p->nil;
+    p->nil = &rbtree_nil;
+    p->root = p->nil;
+    p->leftmost = p->nil;
+    p->rightmost = p->nil;
+  }
+
+  return p;
+}
+
+// 최대 cap개의 노드만 유지하는 rbtree를 할당하여 리턴
+// 가득 찬 뒤의 삽입은 policy에 따라 최소, 최대 또는 가장 오래된 key를 밀어내고
+// 그 노드를 새 key에 다시 쓰므로 할당이 없음
+// parameters : size_t cap, evict_t policy
+// return : rbtree p, cap이 0이거나 실패 시 NULL
+rbtree *new_rbtree_bounded(size_t cap, evict_t policy) {
+  rbtree *p;
+  struct rbtree_ext *e;
+
+  if(cap == 0) {
+    return NULL;
+  }
+  p = new_rbtree();
+  if(p == NULL) {
+    return NULL;
+  }
+  e = ext_of(p);
+  if(e == NULL) {
+    free(p);
+    return NULL;
+  }
+  e->cap = cap;
+  e->policy = policy;
+  if(policy == RBTREE_EVICT_OLDEST) {
+    e->ring = (key_t *)malloc(cap * sizeof(key_t));
+    if(e->ring == NULL) {
+      delete_rbtree(p);
+      return NULL;
     }
   }
 
   return p;
 }
 
-// rbtree t에 대해서 후위 순회하면서 노드를 할당 해제
+// rbtree t에서 root를 루트로 하는 서브트리의 노드를 할당 해제
+// 왼쪽 자식을 위로 올리는 회전으로 트리를 펴 가면서 해제하므로 재귀/스택 없음
 // parameters : rbtree t, node_t root
 // return : void
 static void free_traverse(rbtree* t, node_t* root) {
-    if (root->left != t->nil) {
-      free_traverse(t, root->left);
-    }
-    if (root->right != t->nil) {
-      free_traverse(t, root->right);
+  node_t *x = root;
+
+  while(x != t->nil) {
+    if(x->left == t->nil) {
+      node_t *next = x->right;
+      if(!in_arena(t, x)) {
+        free(x);
+      }
+      x = next;
+    } else {
+      node_t *y = x->left;
+      x->left = y->right;
+      y->right = x;
+      x = y;
     }
-    free(root);
+  }
 }
 
 // rbtree t에 대해 모든 노드를 할당 해제한 후
@@ -38,10 +387,23 @@ static void free_traverse(rbtree* t, node_t* root) {
 // parameters : rbtree t
 // return : void
 void delete_rbtree(rbtree *t) {
+  if(t->wal != NULL) {
+    rbtree_wal_close(t->wal);
+  }
   if(t->root != t->nil) {
     free_traverse(t, t->root);
   }
-  free(t->nil);
+  free(t->small);
+  if(t->ext != NULL) {
+    while(t->ext->slabs != NULL) {
+      struct rbtree_slab *s = t->ext->slabs;
+      t->ext->slabs = s->next;
+      slab_free(s);
+    }
+    free(t->ext->pending);
+    free(t->ext->ring);
+    free(t->ext);
+  }
   free(t);
 }
 
@@ -95,58 +457,285 @@ static void right_rotate(rbtree *t, node_t *node_x) {
   node_x->parent = node_y;
 }
 
+// red인 z와 그 red 부모에 대해 CLRS 삽입 fixup을 한 단계 수행
+// z의 조부모는 black이어야 함 (정상적인 rbtree에서는 항상 성립)
+// parameter : rbtree t, node_t z
+// return : 다음에 확인할 노드 (case 1에서 red가 된 조부모), 끝났으면 NULL
+static node_t *rb_insert_fixup_once(rbtree *t, node_t *z) {
+  node_t *y = NULL;
+
+  if(z->parent == z->parent->parent->left) {
+    y = z->parent->parent->right;
+
+    if(y->color == RBTREE_RED) {
+      z->parent->color = RBTREE_BLACK;
+      y->color = RBTREE_BLACK;
+      z->parent->parent->color = RBTREE_RED;
+      return z->parent->parent;
+    }
+    if(z == z->parent->right) {
+      z = z->parent;
+      left_rotate(t, z); 
+    }
+    z->parent->color = RBTREE_BLACK;
+    z->parent->parent->color = RBTREE_RED;
+    right_rotate(t, z->parent->parent);
+  } else {
+    y = z->parent->parent->left;
+
+    if(y->color == RBTREE_RED) {
+      z->parent->color = RBTREE_BLACK;
+      y->color = RBTREE_BLACK;
+      z->parent->parent->color = RBTREE_RED;
+      return z->parent->parent;
+    }
+    if(z == z->parent->left) {
+      z = z->parent;
+      right_rotate(t, z); 
+    }
+    z->parent->color = RBTREE_BLACK;
+    z->parent->parent->color = RBTREE_RED;
+    left_rotate(t, z->parent->parent);
+  }
+
+  return NULL;
+}
+
 // rbtree t에 대해 z 노드를 삽입한 후
 // t가 rbtree에 해당하는지 확인
 // parameter : rbtree t, node_t z
 // return : void
 static void rb_insert_fixup(rbtree *t, node_t *z) {
-  while(z->parent->color == RBTREE_RED) {
-    node_t *y = NULL;
+  while(z != NULL && z->parent->color == RBTREE_RED) {
+    z = rb_insert_fixup_once(t, z);
+  }
+  t->root->color = RBTREE_BLACK;
+}
 
-    if(z->parent == z->parent->parent->left) {
-      y = z->parent->parent->right;
+// relaxed mode의 위반 기록 ring에 최소 한 칸의 여유를 확보
+// 늘릴 때는 가장 오래된 기록이 앞에 오도록 펼쳐서 복사
+// parameters : rbtree t
+// return : 성공 시 1, 메모리 부족 시 0
+static int pending_reserve(rbtree *t) {
+  struct rbtree_ext *e = t->ext;
 
-      if(y->color == RBTREE_RED) {
-        z->parent->color = RBTREE_BLACK;
-        y->color = RBTREE_BLACK;
-        z->parent->parent->color = RBTREE_RED;
-        z = z->parent->parent;
-      } else {
-        if(z == z->parent->right) {
-          z = z->parent;
-          left_rotate(t, z); 
-        }
-        z->parent->color = RBTREE_BLACK;
-        z->parent->parent->color = RBTREE_RED;
-        right_rotate(t, z->parent->parent);
-      }
-    } else {
-      y = z->parent->parent->left;
+  if(e->npending == e->pending_cap) {
+    size_t cap = e->pending_cap ? e->pending_cap * 2 : 64;
+    node_t **p = (node_t **)malloc(cap * sizeof(node_t *));
+    if(p == NULL) {
+      return 0;
+    }
+    for(size_t i = 0; i < e->npending; i++) {
+      p[i] = e->pending[(e->pending_head + i) % e->pending_cap];
+    }
+    free(e->pending);
+    e->pending = p;
+    e->pending_cap = cap;
+    e->pending_head = 0;
+  }
 
-      if(y->color == RBTREE_RED) {
-        z->parent->color = RBTREE_BLACK;
-        y->color = RBTREE_BLACK;
-        z->parent->parent->color = RBTREE_RED;
-        z = z->parent->parent;
-      } else {
-        if(z == z->parent->left) {
-          z = z->parent;
-          right_rotate(t, z); 
+  return 1;
+}
+
+// relaxed mode에서 미뤄 둔 red-red 위반 노드를 기록
+// parameters : rbtree t, node_t z
+// return : 성공 시 1, 메모리 부족 시 0
+static int pending_push(rbtree *t, node_t *z) {
+  if(!pending_reserve(t)) {
+    return 0;
+  }
+  t->ext->pending[(t->ext->pending_head + t->ext->npending++) % t->ext->pending_cap] = z;
+
+  return 1;
+}
+
+// 가장 오래된 위반 기록을 버림
+static void pending_pop(struct rbtree_ext *e) {
+  e->pending_head = (e->pending_head + 1) % e->pending_cap;
+  e->npending--;
+}
+
+// 노드 p를 가리키는 기록을 모두 지움 (p를 트리에서 떼어내기 전에 호출)
+// 순서는 유지하며 비용은 남은 기록 수에 비례
+// parameters : rbtree t, node_t p
+// return : void
+static void pending_forget(rbtree *t, const node_t *p) {
+  struct rbtree_ext *e = t->ext;
+  size_t k = 0;
+
+  for(size_t i = 0; i < e->npending; i++) {
+    node_t *z = e->pending[(e->pending_head + i) % e->pending_cap];
+    if(z != p) {
+      e->pending[(e->pending_head + k++) % e->pending_cap] = z;
+    }
+  }
+  e->npending = k;
+}
+
+// red인 z와 그 부모 사이의 red-red 위반을 고치고, case 1로 조부모에 생긴 위반도 이어서 고침
+// relaxed mode에서는 red가 최대 두 개까지만 연달아 놓이므로 z의 부모도 위반이면
+// 그 위반의 조부모는 black이고, 그것을 먼저 고친 뒤 z를 다시 확인
+// parameter : rbtree t, node_t z
+// return : void
+static void relax_fix(rbtree *t, node_t *z) {
+  while(z != NULL && z->color == RBTREE_RED && z->parent->color == RBTREE_RED) {
+    if(z->parent->parent->color == RBTREE_RED) {
+      relax_fix(t, z->parent);
+      continue;
+    }
+    z = rb_insert_fixup_once(t, z);
+    t->root->color = RBTREE_BLACK;
+  }
+}
+
+// relaxed mode에서 미뤄 둔 위반을 가장 오래된 기록부터 fixup 최대 budget 단계만큼 정리
+// case 1(색 바꾸기)로 조부모에 위반이 옮겨 가면 기록을 그 조부모로 바꿔 맨 앞에 남겨 둠
+// 이미 해소된 기록은 단계로 세지 않고 바로 버림
+// 옮겨 간 위반 위로 red가 세 개 연달아 놓이게 되면 그 위의 위반만은 budget과 상관없이 고쳐서
+// red가 두 개까지만 연달아 놓이게 유지
+// parameters : rbtree t, size_t budget
+// return : 남은 위반 기록 수, 0이면 t는 다시 rbtree 조건을 만족
+size_t rbtree_rebalance(rbtree *t, size_t budget) {
+  struct rbtree_ext *e = t->ext;
+
+  if(e == NULL) {
+    return 0;
+  }
+  while(e->npending > 0) {
+    node_t *z = e->pending[e->pending_head];
+
+    if(z->color != RBTREE_RED || z->parent->color != RBTREE_RED) {
+      pending_pop(e);
+      continue;
+    }
+    if(budget == 0) {
+      break;
+    }
+    budget--;
+    z = rb_insert_fixup_once(t, z);
+    t->root->color = RBTREE_BLACK;
+    if(z == NULL || z->parent->color != RBTREE_RED) {
+      pending_pop(e);
+      continue;
+    }
+    e->pending[e->pending_head] = z;
+    if(z->parent->parent->color == RBTREE_RED) {
+      relax_fix(t, z->parent);
+    }
+  }
+
+  return e->npending;
+}
+
+static node_t *node_min(const rbtree *t, node_t *z);
+
+// 노드 p를 지우기 전에, 삭제 fixup이 보는 노드들 사이의 red-red 위반만 골라 고침
+// 삭제 fixup은 떼어낼 자리에서 루트까지의 경로, 그 경로 노드의 형제와 형제의 자식 색을 보며
+// 나머지 위반은 black 높이에 영향이 없으므로 기록에 그대로 남겨 둠
+// relax_fix의 회전으로 경로가 바뀔 수 있으므로 위반을 고칠 때마다 처음부터 다시 훑음
+// parameters : rbtree t, node_t p
+// return : void
+static void relax_clear_path(rbtree *t, node_t *p) {
+  int fixed = 1;
+
+  pending_forget(t, p);
+  while(fixed) {
+    // 두 자식이 있으면 실제로 떼어내는 자리는 다음 노드
+    node_t *a = (p->left != t->nil && p->right != t->nil) ? node_min(t, p->right) : p;
+
+    fixed = 0;
+    for(; a != t->nil && !fixed; a = a->parent) {
+      node_t *s = a->parent == t->nil ? t->nil : (a == a->parent->left ? a->parent->right : a->parent->left);
+      node_t *check[4] = {a, s, s != t->nil ? s->left : t->nil, s != t->nil ? s->right : t->nil};
+
+      for(int i = 0; i < 4 && !fixed; i++) {
+        node_t *z = check[i];
+        if(z != t->nil && z->color == RBTREE_RED && z->parent->color == RBTREE_RED) {
+          relax_fix(t, z);
+          fixed = 1;
         }
-        z->parent->color = RBTREE_BLACK;
-        z->parent->parent->color = RBTREE_RED;
-        left_rotate(t, z->parent->parent);
       }
     }
   }
-  t->root->color = RBTREE_BLACK;
+}
+
+// relaxed mode를 켜거나 끔
+// 켜져 있으면 삽입은 red-red 위반을 기록만 하고, 매 삽입마다 fixup을 budget 단계씩 진행
+// 기록이 남아 있어도 red는 두 개까지만 연달아 놓이므로 높이는 3 log2(n + 1) + 2 이하
+// 끌 때는 남은 작업을 모두 정리하여 정상적인 rbtree로 되돌림
+// 상태를 담을 메모리가 없으면 켜지 않고 eager 삽입을 유지
+// parameters : rbtree t, int relaxed, size_t budget
+// return : void
+void rbtree_set_relaxed(rbtree *t, int relaxed, size_t budget) {
+  struct rbtree_ext *e = relaxed ? ext_of(t) : t->ext;
+
+  if(e == NULL) {
+    return;
+  }
+  e->relaxed = relaxed;
+  e->relax_budget = budget;
+  if(!relaxed) {
+    rbtree_rebalance(t, SIZE_MAX);
+  }
+}
+
+static void rb_unlink(rbtree *t, node_t *p);
+
+// 가득 찬 bounded rbtree t에서 key를 넣기 위해 밀어낼 노드를 트리에서 떼어 리턴
+// 최소/최대 정책은 캐시된 끝 노드와 한 번 비교하여 바로 밀려날 key를 거절
+// parameters : rbtree t, key_t key
+// return : node_t victim, 거절 시 NULL
+static node_t *bounded_evict(rbtree *t, const key_t key) {
+  struct rbtree_ext *e = t->ext;
+  node_t *victim;
+
+  if(e->policy == RBTREE_EVICT_MIN) {
+    if(key <= t->leftmost->key) {
+      return NULL;
+    }
+    victim = t->leftmost;
+  } else if(e->policy == RBTREE_EVICT_MAX) {
+    if(key >= t->rightmost->key) {
+      return NULL;
+    }
+    victim = t->rightmost;
+  } else {
+    victim = rbtree_find(t, e->ring[e->ring_head]);
+    e->ring_head = (e->ring_head + 1) % e->cap;
+  }
+  rb_unlink(t, victim);
+
+  return victim;
 }
 
 // rbtree t에 대해 입력받은 key_t key값을 가지는 노드를 삽입
+// bounded 트리가 가득 찼으면 밀어낸 노드를 새 노드로 다시 씀
 // parameters : rbtree t, key_t key
-// return : node_t new_node
+// return : node_t new_node, bounded 트리에서 거절되거나 할당 또는 log가 실패하면 NULL (트리는 그대로)
 node_t *rbtree_insert(rbtree *t, const key_t key) {
-  node_t *new_node = (node_t *)calloc(1, sizeof(node_t));
+  struct rbtree_ext *e = t->ext;
+  node_t *new_node;
+
+  if(t->wal != NULL && rbtree_wal_failed(t->wal)) {
+    return NULL;
+  }
+  if(e != NULL && e->cap > 0 && t->size >= e->cap) {
+    new_node = bounded_evict(t, key);
+    if(new_node == NULL) {
+      return NULL;
+    }
+  } else {
+    new_node = node_alloc(t);
+    if(new_node == NULL) {
+      return NULL;
+    }
+  }
+  // 트리를 바꾸기 전에 log에 먼저 기록하고, 실패하면 아무것도 바꾸지 않고 돌아감
+  // durable 트리는 bounded가 아니므로 위에서 밀려난 노드는 없음
+  if(t->wal != NULL && !rbtree_wal_append(t, RBTREE_WAL_INSERT, key)) {
+    node_free(t, new_node);
+    return NULL;
+  }
 
   new_node->color = RBTREE_RED;
   new_node->key = key;
@@ -179,8 +768,38 @@ node_t *rbtree_insert(rbtree *t, const key_t key) {
     }
   }
 
-  rb_insert_fixup(t, new_node);
-   
+  if(t->leftmost == t->nil || key < t->leftmost->key) {
+    t->leftmost = new_node;
+  }
+  if(t->rightmost == t->nil || key >= t->rightmost->key) {
+    t->rightmost = new_node;
+  }
+
+  if(e == NULL || !e->relaxed) {
+    rb_insert_fixup(t, new_node);
+  } else {
+    // 부모가 이미 위반이면 그것부터 고쳐서 red가 세 개 연달아 놓이지 않게 함
+    while(new_node->parent->color == RBTREE_RED &&
+          new_node->parent->parent->color == RBTREE_RED) {
+      relax_fix(t, new_node->parent);
+    }
+    if(new_node->parent->color == RBTREE_RED && !pending_push(t, new_node)) {
+      // 기록할 메모리가 없으면 바로 fixup
+      relax_fix(t, new_node);
+    }
+    t->root->color = RBTREE_BLACK;
+    rbtree_rebalance(t, e->relax_budget);
+  }
+  small_add(t, new_node);
+  if(e != NULL && e->ring != NULL) {
+    e->ring[(e->ring_head + t->size) % e->cap] = key;
+  }
+  t->size++;
+
+  if(t->wal != NULL) {
+    rbtree_wal_applied(t);
+  }
+
   return new_node;
 }
 
@@ -191,6 +810,16 @@ node_t *rbtree_insert(rbtree *t, const key_t key) {
 node_t *rbtree_find(const rbtree *t, const key_t key) {
   node_t *x = t->root;
 
+  // 작은 트리는 연속된 key 배열에서 key보다 작은 개수를 세어 바로 찾음
+  if(t->small != NULL && t->small->indexed) {
+    const struct rbtree_small *s = t->small;
+    size_t pos = 0;
+    for(int i = 0; i < RBTREE_SMALL_MAX; i++) {
+      pos += s->keys[i] < key;
+    }
+    return (pos < t->size && s->keys[pos] == key) ? (node_t *)&s->nodes[s->slot[pos]] : NULL;
+  }
+
   while(x != t->nil) {
     if(x->key == key) {
       return x;
@@ -206,18 +835,11 @@ node_t *rbtree_find(const rbtree *t, const key_t key) {
 }
 
 // rbtree t에 대해 가장 작은 값의 key를 가지는 노드를 반환
+// insert/erase가 갱신하는 leftmost를 그대로 돌려주므로 O(1)
 // parameters : rbtree t
-// return : node_t y
+// return : node_t leftmost
 node_t *rbtree_min(const rbtree *t) {
-  node_t *x = t->root;
-  node_t *y = t->nil;
-
-  while(x != t->nil) {
-    y = x;
-    x = x->left;
-  }
-
-  return y;
+  return t->leftmost;
 }
 
 // rbtree t에 대해 root를 node_t z 노드로 가지는 서브트리에서
@@ -236,11 +858,12 @@ static node_t *node_min(const rbtree *t, node_t *z) {
   return y;
 }
 
-// rbtree t에 대해 가장 최대값의 key를 가지는 노드를 반환
-// parameters : rbtree t
+// rbtree t에 대해 root를 node_t z 노드로 가지는 서브트리에서
+// 가장 큰 값의 key를 가지는 노드를 반환
+// parameters : rbtree t, node_t z
 // return : node_t y
-node_t *rbtree_max(const rbtree *t) {
-  node_t *x = t->root;
+static node_t *node_max(const rbtree *t, node_t *z) {
+  node_t *x = z;
   node_t *y = t->nil;
 
   while(x != t->nil) {
@@ -251,6 +874,14 @@ node_t *rbtree_max(const rbtree *t) {
   return y;
 }
 
+// rbtree t에 대해 가장 최대값의 key를 가지는 노드를 반환
+// insert/erase가 갱신하는 rightmost를 그대로 돌려주므로 O(1)
+// parameters : rbtree t
+// return : node_t rightmost
+node_t *rbtree_max(const rbtree *t) {
+  return t->rightmost;
+}
+
 // rbtree t에 대해 node_t u의 자리에 node_t v를 설정
 // u의 부모를 v의 부모로, u의 부모의 자식을 v로
 // parameters : rbtree t, node_t u, node_t v
@@ -263,93 +894,113 @@ static void rb_transplant(rbtree *t, node_t *u, node_t *v) {
   } else {
     u->parent->right = v;
   }
-  v->parent = u->parent;
+  if(v != t->nil) {
+    v->parent = u->parent;
+  }
 }
 
 // rbtree t에 대해 node_x가 있던 자리의 노드가 삭제됐을 때
 // t가 rbtree로 성립하는지 확인
-// parameters : rbtree t, node_t
+// nil은 공유되므로 x가 nil일 수 있는 x의 부모는 xp로 따로 받음
+// parameters : rbtree t, node_t x, node_t xp
 // return : void
-static void rb_delete_fixup(rbtree *t, node_t *x) {
+static void rb_delete_fixup(rbtree *t, node_t *x, node_t *xp) {
   while(x != t->root && x->color == RBTREE_BLACK) {
     node_t *w = t->nil;
 
-    if(x == x->parent->left) {
-      w = x->parent->right;
+    if(x == xp->left) {
+      w = xp->right;
       
       if(w->color == RBTREE_RED) {
         w->color = RBTREE_BLACK;
-        x->parent->color = RBTREE_RED;
-        left_rotate(t, x->parent);
-        w = x->parent->right;
+        xp->color = RBTREE_RED;
+        left_rotate(t, xp);
+        w = xp->right;
       }
 
       if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
         w->color = RBTREE_RED;
-        x = x->parent;
+        x = xp;
+        xp = x->parent;
       } else {
         if(w->right->color == RBTREE_BLACK) {
           w->left->color = RBTREE_BLACK;
           w->color = RBTREE_RED;
           right_rotate(t, w);
-          w = x->parent->right;
+          w = xp->right;
         }
 
-        w->color = x->parent->color;
-        x->parent->color = RBTREE_BLACK;
+        w->color = xp->color;
+        xp->color = RBTREE_BLACK;
         w->right->color = RBTREE_BLACK;
-        left_rotate(t,x->parent);
+        left_rotate(t,xp);
         x = t->root;
       }
     } else {
-      w = x->parent->left;
+      w = xp->left;
       
       if(w->color == RBTREE_RED) {
         w->color = RBTREE_BLACK;
-        x->parent->color = RBTREE_RED;
-        right_rotate(t, x->parent);
-        w = x->parent->left;
+        xp->color = RBTREE_RED;
+        right_rotate(t, xp);
+        w = xp->left;
       }
 
       if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
         w->color = RBTREE_RED;
-        x = x->parent;
+        x = xp;
+        xp = x->parent;
       } else {
         if(w->left->color == RBTREE_BLACK) {
           w->right->color = RBTREE_BLACK;
           w->color = RBTREE_RED;
           left_rotate(t, w);
-          w = x->parent->left;
+          w = xp->left;
         }
 
-        w->color = x->parent->color;
-        x->parent->color = RBTREE_BLACK;
+        w->color = xp->color;
+        xp->color = RBTREE_BLACK;
         w->left->color = RBTREE_BLACK;
-        right_rotate(t,x->parent);
+        right_rotate(t,xp);
         x = t->root;
       }
     }
   }
-  x->color = RBTREE_BLACK;
+  if(x != t->nil) {
+    x->color = RBTREE_BLACK;
+  }
 }
 
-// rbtree t에 대해 node_t p가 있다면 삭제
+// rbtree t에서 노드 p를 떼어내고 캐시, size, small index를 갱신 (p는 해제하지 않음)
 // parameters : rbtree t, node_t p
-// return : 성공 시 1, 실패 시 0
-int rbtree_erase(rbtree *t, node_t *p) {
+// return : void
+static void rb_unlink(rbtree *t, node_t *p) {
   node_t *y = p;
-  node_t *x;
-  int y_origin_color = y->color;
+  node_t *x, *xp;
+  int y_origin_color;
 
-  if(p == NULL || p == t->nil) {
-    return 0;
+  // 삭제 fixup이 지나갈 자리의 밀린 삽입 작업만 먼저 정리
+  if(t->ext != NULL && t->ext->npending > 0) {
+    relax_clear_path(t, p);
+  }
+  y_origin_color = y->color;
+
+  // 최소 노드는 왼쪽 자식이 없으므로 다음 노드는 오른쪽 서브트리의 최소 또는 부모
+  // 최대 노드도 대칭으로 처리하며, 삭제 과정에서 다른 노드의 위치만 바뀌므로 유효함
+  if(p == t->leftmost) {
+    t->leftmost = (p->right != t->nil) ? node_min(t, p->right) : p->parent;
+  }
+  if(p == t->rightmost) {
+    t->rightmost = (p->left != t->nil) ? node_max(t, p->left) : p->parent;
   }
 
   if(p->left == t->nil) {
     x = p->right;
+    xp = p->parent;
     rb_transplant(t, p, p->right);
   } else if(p->right == t->nil) {
     x = p->left;
+    xp = p->parent;
     rb_transplant(t, p, p->left);
   } else {
     y = node_min(t, p->right);
@@ -357,8 +1008,9 @@ int rbtree_erase(rbtree *t, node_t *p) {
     x = y->right;
 
     if(y->parent == p) {
-      x->parent = y;
+      xp = y;
     } else {
+      xp = y->parent;
       rb_transplant(t, y, y->right);
       y->right = p->right;
       y->right->parent = y;
@@ -370,10 +1022,217 @@ int rbtree_erase(rbtree *t, node_t *p) {
   }
 
   if(y_origin_color == RBTREE_BLACK) {
-    rb_delete_fixup(t, x);
+    rb_delete_fixup(t, x, xp);
+  }
+
+  t->size--;
+  small_remove(t, p);
+}
+
+// rbtree t에 대해 node_t p가 있다면 삭제
+// RBTREE_EVICT_OLDEST 트리는 삽입 순서 ring에서도 같은 key 하나를 빼므로 O(cap)
+// parameters : rbtree t, node_t p
+// return : 성공 시 1, 실패 시 0 (log가 실패한 durable 트리는 그대로 둠)
+int rbtree_erase(rbtree *t, node_t *p) {
+  if(p == NULL || p == t->nil) {
+    return 0;
+  }
+  if(t->wal != NULL && !rbtree_wal_append(t, RBTREE_WAL_ERASE, p->key)) {
+    return 0;
+  }
+  if(t->ext != NULL && t->ext->ring != NULL) {
+    // 같은 key는 구별되지 않으므로 가장 오래된 것을 지우고 뒤의 key를 한 칸씩 당김
+    struct rbtree_ext *e = t->ext;
+    size_t i = 0;
+    while(e->ring[(e->ring_head + i) % e->cap] != p->key) {
+      i++;
+    }
+    for(; i + 1 < t->size; i++) {
+      e->ring[(e->ring_head + i) % e->cap] = e->ring[(e->ring_head + i + 1) % e->cap];
+    }
+  }
+  rb_unlink(t, p);
+  node_free(t, p);
+
+  if(t->wal != NULL) {
+    rbtree_wal_applied(t);
+  }
+
+  return 1;
+}
+
+// rbtree t의 최소 key를 key_t *key에 저장 (노드는 그대로 둠)
+// parameters : rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0
+int rbtree_peek_min(const rbtree *t, key_t *key) {
+  if(t->leftmost == t->nil) {
+    return 0;
+  }
+  *key = t->leftmost->key;
+  return 1;
+}
+
+// rbtree t의 최대 key를 key_t *key에 저장 (노드는 그대로 둠)
+// parameters : rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0
+int rbtree_peek_max(const rbtree *t, key_t *key) {
+  if(t->rightmost == t->nil) {
+    return 0;
+  }
+  *key = t->rightmost->key;
+  return 1;
+}
+
+// rbtree t의 최소 노드를 삭제하고 그 key를 key_t *key에 저장
+// 다음 최소 노드는 rbtree_erase가 successor 링크로 구하므로 다시 내려가지 않음
+// parameters : rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0
+int rbtree_pop_min(rbtree *t, key_t *key) {
+  if(!rbtree_peek_min(t, key)) {
+    return 0;
+  }
+  return rbtree_erase(t, t->leftmost);
+}
+
+// rbtree t의 최대 노드를 삭제하고 그 key를 key_t *key에 저장
+// parameters : rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0
+int rbtree_pop_max(rbtree *t, key_t *key) {
+  if(!rbtree_peek_max(t, key)) {
+    return 0;
+  }
+  return rbtree_erase(t, t->rightmost);
+}
+
+// 노드 p의 내용을 빈 칸 q로 옮기고 p를 가리키던 링크와 캐시를 모두 q로 바꾼 후 p를 해제
+// parameters : rbtree t, node_t p, node_t q
+// return : void
+static void node_move(rbtree *t, node_t *p, node_t *q) {
+  *q = *p;
+
+  if(q->parent == t->nil) {
+    t->root = q;
+  } else if(q->parent->left == p) {
+    q->parent->left = q;
+  } else {
+    q->parent->right = q;
+  }
+  if(q->left != t->nil) {
+    q->left->parent = q;
+  }
+  if(q->right != t->nil) {
+    q->right->parent = q;
+  }
+  if(t->leftmost == p) {
+    t->leftmost = q;
+  }
+  if(t->rightmost == p) {
+    t->rightmost = q;
+  }
+  if(t->small != NULL) {
+    // q는 slot 밖에 있으므로 index를 버림
+    t->small->indexed = 0;
+  }
+
+  node_free(t, p);
+}
+
+// rbtree t의 노드를 새 slab에 BFS 순서로 옮기는 작업을 최대 budget만큼 진행
+// slab 자체를 BFS queue로 쓰므로(Cheney 방식) 추가 메모리가 없고,
+// 단계 사이에 insert/erase가 일어나도 트리는 항상 올바름 (놓친 노드는 제자리에 남음)
+// 옮겨진 노드의 주소가 바뀌므로 이전에 받은 node_t 포인터는 무효가 됨
+// parameters : rbtree t, size_t budget (방문한 칸 + 옮긴 노드 수)
+// return : compaction이 끝났으면 1, 남은 작업이 있으면 0
+int rbtree_compact_step(rbtree *t, size_t budget) {
+  struct rbtree_ext *e = ext_of(t);
+  struct rbtree_slab *s;
+
+  if(e == NULL) {
+    return 1;
+  }
+  // 기록된 위반 노드의 주소가 바뀌지 않도록 밀린 삽입 작업을 먼저 정리
+  if(e->npending > 0) {
+    rbtree_rebalance(t, SIZE_MAX);
+  }
+  s = e->compacting;
+  if(s == NULL) {
+    if(t->root == t->nil || budget == 0) {
+      return t->root == t->nil;
+    }
+    s = slab_new(t->size);
+    if(s == NULL) {
+      return 1;
+    }
+    s->next = e->slabs;
+    e->slabs = s;
+    e->compacting = s;
+    e->scan = 0;
+    s->used = s->live = 1;
+    node_move(t, t->root, &s->nodes[0]);
+    budget--;
+  }
+
+  while(e->scan < s->used) {
+    node_t *q = &s->nodes[e->scan];
+
+    if(budget == 0) {
+      return 0;
+    }
+    budget--;
+
+    for(int i = 0; i < 2 && q->parent != NULL; i++) {
+      node_t *c = (i == 0) ? q->left : q->right;
+
+      if(c == t->nil || (c >= s->nodes && c < s->nodes + s->cap) || s->used == s->cap) {
+        continue;
+      }
+      if(budget == 0) {
+        return 0;
+      }
+      budget--;
+      s->live++;
+      node_move(t, c, &s->nodes[s->used++]);
+    }
+    e->scan++;
+  }
+
+  e->compacting = NULL;
+  // 진행 중에 모든 노드가 지워졌다면 대상 slab도 바로 반환
+  if(s->live == 0) {
+    slab_release(t, s);
+  }
+
+  return 1;
+}
+
+// rbtree t의 모든 노드를 연속된 메모리에 BFS 순서로 다시 배치
+// 상위 레벨 노드들이 몇 개의 page에 모여 검색 시 TLB/cache miss가 줄어듦
+// 새 slab은 현재 size만큼만 잡으므로 대량 삭제 뒤에 부르면 옛 slab의 메모리도 반환됨
+// parameters : rbtree t
+// return : void
+void rbtree_compact(rbtree *t) {
+  while(!rbtree_compact_step(t, SIZE_MAX)) {
   }
+}
+
+// 노드 n개를 담는 slab을 미리 만들어 이후 삽입이 노드마다 malloc하지 않게 함
+// 모든 칸이 free list에 들어가며, 다 쓰면 다시 malloc으로 돌아감
+// parameters : rbtree t, size_t n
+// return : 성공 시 1, 실패 시 0
+int rbtree_reserve(rbtree *t, const size_t n) {
+  struct rbtree_ext *e = ext_of(t);
+  struct rbtree_slab *s;
 
-  free(p);
+  if(e == NULL || n == 0 || (s = slab_new(n)) == NULL) {
+    return 0;
+  }
+  for(size_t i = 0; i < n; i++) {
+    s->nodes[i].left = i + 1 < n ? &s->nodes[i + 1] : NULL;
+  }
+  s->free = s->nodes;
+  s->used = n;
+  s->next = e->slabs;
+  e->slabs = s;
 
   return 1;
 }
@@ -399,7 +1258,9 @@ int rbtree_to_array(const rbtree *t, key_t *arr, const size_t n) {
   int idx_val = 0;
   idx = &idx_val;
 
-  inorder_traversal(t, t->root, arr, idx);
+  if(t->root != t->nil) {
+    inorder_traversal(t, t->root, arr, idx);
+  }
 
   int result = 0;
   if((sizeof(arr) / sizeof(key_t)) == n) {
@@ -408,3 +1269,546 @@ int rbtree_to_array(const rbtree *t, key_t *arr, const size_t n) {
 
   return result;
 }
+
+// 병렬 연산이 쓰는 최대 스레드 수, 더 큰 요청은 이 값으로 줄임
+#define RBTREE_MAX_THREADS 256
+
+// 요청된 스레드 수를 1 이상 RBTREE_MAX_THREADS 이하로 맞춤
+// parameters : int nthreads
+// return : int
+static int clamp_threads(const int nthreads) {
+  if(nthreads < 1) {
+    return 1;
+  }
+  return nthreads > RBTREE_MAX_THREADS ? RBTREE_MAX_THREADS : nthreads;
+}
+
+// 병렬 순회에서 트리를 나누는 단위
+// whole이 1이면 node를 루트로 하는 서브트리 전체, 0이면 node 하나만 의미
+typedef struct {
+  node_t *node;
+  int whole;
+  size_t count, offset;
+} par_item;
+
+enum { PAR_COUNT, PAR_VISIT, PAR_FREE };
+
+typedef struct {
+  const rbtree *t;
+  par_item *items;
+  size_t nitems;
+  atomic_size_t next;
+  int phase;
+  key_t *arr;
+  size_t n;
+  rbtree_visit_t fn;
+  void *arg;
+} par_ctx;
+
+// rbtree t의 상위 depth 레벨을 중위 순서대로 펼쳐 c->items에 추가
+// depth 레벨에 도달한 노드는 서브트리 전체를 하나의 item으로 추가
+// parameters : rbtree t, node_t x, int depth, par_ctx c
+// return : void
+static void par_split(const rbtree *t, node_t *x, int depth, par_ctx *c) {
+  if(x == t->nil) {
+    return;
+  }
+  if(depth == 0) {
+    c->items[c->nitems++] = (par_item){x, 1, 0, 0};
+    return;
+  }
+  par_split(t, x->left, depth - 1, c);
+  c->items[c->nitems++] = (par_item){x, 0, 1, 0};
+  par_split(t, x->right, depth - 1, c);
+}
+
+// root를 루트로 하는 서브트리를 parent 링크로 중위 순회
+// 순서상 idx번째 노드부터 c->n 전까지 배열에 쓰거나 c->fn을 호출
+// parameters : par_ctx c, node_t root, size_t idx
+// return : 방문한 노드 수
+static size_t par_walk(par_ctx *c, node_t *root, size_t idx) {
+  const rbtree *t = c->t;
+  node_t *stop = root->parent;
+  node_t *x = node_min(t, root);
+  size_t i = 0;
+
+  while(x != stop && idx + i < c->n) {
+    if(c->phase == PAR_VISIT) {
+      if(c->arr != NULL) {
+        c->arr[idx + i] = x->key;
+      } else {
+        c->fn(x, idx + i, c->arg);
+      }
+    }
+    i++;
+
+    if(x->right != t->nil) {
+      x = node_min(t, x->right);
+    } else {
+      node_t *y = x->parent;
+      while(y != stop && x == y->right) {
+        x = y;
+        y = y->parent;
+      }
+      x = y;
+    }
+  }
+
+  return i;
+}
+
+// 남은 item을 하나씩 가져와 현재 phase의 작업을 수행
+// parameters : par_ctx c
+// return : NULL
+static void *par_worker(void *p) {
+  par_ctx *c = (par_ctx *)p;
+  size_t i;
+
+  while((i = atomic_fetch_add(&c->next, 1)) < c->nitems) {
+    par_item *it = &c->items[i];
+
+    if(c->phase == PAR_FREE) {
+      if(it->whole) {
+        free_traverse((rbtree *)c->t, it->node);
+      }
+    } else if(it->whole) {
+      if(c->phase == PAR_COUNT) {
+        it->count = par_walk(c, it->node, 0);
+      } else if(it->offset < c->n) {
+        par_walk(c, it->node, it->offset);
+      }
+    } else if(c->phase == PAR_VISIT && it->offset < c->n) {
+      if(c->arr != NULL) {
+        c->arr[it->offset] = it->node->key;
+      } else {
+        c->fn(it->node, it->offset, c->arg);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+// c의 현재 phase를 nthreads개의 스레드로 실행
+// parameters : par_ctx c, int nthreads
+// return : void
+static void par_run(par_ctx *c, int nthreads) {
+  pthread_t *tids = (pthread_t *)calloc(nthreads, sizeof(pthread_t));
+  int spawned = 0;
+
+  atomic_store(&c->next, 0);
+  // 배열을 할당하지 못하면 호출한 스레드 혼자 모든 item을 처리
+  for(int i = 1; i < nthreads && tids != NULL; i++) {
+    if(pthread_create(&tids[spawned], NULL, par_worker, c) == 0) {
+      spawned++;
+    }
+  }
+  par_worker(c);
+  for(int i = 0; i < spawned; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  free(tids);
+}
+
+// rbtree t를 스레드 수의 약 4배 개수의 item으로 나눔
+// parameters : par_ctx c, rbtree t, int nthreads
+// return : 성공 시 1, 실패 시 0
+static int par_init(par_ctx *c, const rbtree *t, int nthreads) {
+  int depth = 0;
+
+  while(((size_t)1 << depth) < (size_t)nthreads * 4) {
+    depth++;
+  }
+  if(nthreads == 1) {
+    depth = 0;
+  }
+
+  memset(c, 0, sizeof(*c));
+  c->t = t;
+  c->n = SIZE_MAX;
+  c->items = (par_item *)malloc(((size_t)2 << depth) * sizeof(par_item));
+  if(c->items == NULL) {
+    return 0;
+  }
+  par_split(t, t->root, depth, c);
+
+  return 1;
+}
+
+// 각 item의 노드 수를 병렬로 센 후 누적하여 출력 위치 offset을 계산
+// parameters : par_ctx c, int nthreads
+// return : void
+static void par_offsets(par_ctx *c, int nthreads) {
+  size_t sum = 0;
+
+  c->phase = PAR_COUNT;
+  par_run(c, nthreads);
+  for(size_t i = 0; i < c->nitems; i++) {
+    c->items[i].offset = sum;
+    sum += c->items[i].count;
+  }
+}
+
+// rbtree t를 중위 순서대로 key_t *arr에 최대 n개까지 병렬로 기록
+// 상위 서브트리별 노드 수로 offset을 구하고 각 스레드가 겹치지 않는 구간을 채움
+// parameters : rbtree t, key_t *arr, size_t n, int nthreads
+// return : 성공 시 1, 실패 시 0
+int rbtree_to_array_parallel(const rbtree *t, key_t *arr, const size_t n, int nthreads) {
+  par_ctx c;
+
+  nthreads = clamp_threads(nthreads);
+  if(!par_init(&c, t, nthreads)) {
+    return 0;
+  }
+  par_offsets(&c, nthreads);
+
+  c.phase = PAR_VISIT;
+  c.arr = arr;
+  c.n = n;
+  par_run(&c, nthreads);
+
+  free(c.items);
+
+  return 1;
+}
+
+// rbtree t의 모든 노드에 대해 fn(node, 중위 순서 index, arg)을 병렬로 호출
+// 호출 순서는 정해져 있지 않으며 fn은 여러 스레드에서 동시에 불릴 수 있음
+// parameters : rbtree t, rbtree_visit_t fn, void *arg, int nthreads
+// return : 성공 시 1, 실패 시 0
+int rbtree_foreach(const rbtree *t, rbtree_visit_t fn, void *arg, int nthreads) {
+  par_ctx c;
+
+  nthreads = clamp_threads(nthreads);
+  if(!par_init(&c, t, nthreads)) {
+    return 0;
+  }
+  par_offsets(&c, nthreads);
+
+  c.phase = PAR_VISIT;
+  c.fn = fn;
+  c.arg = arg;
+  par_run(&c, nthreads);
+
+  free(c.items);
+
+  return 1;
+}
+
+// delete_rbtree와 같지만 상위 서브트리들을 여러 스레드가 나누어 해제
+// parameters : rbtree t, int nthreads
+// return : void
+void delete_rbtree_parallel(rbtree *t, int nthreads) {
+  par_ctx c;
+
+  nthreads = clamp_threads(nthreads);
+  if(nthreads == 1 || !par_init(&c, t, nthreads)) {
+    delete_rbtree(t);
+    return;
+  }
+
+  c.phase = PAR_FREE;
+  par_run(&c, nthreads);
+  for(size_t i = 0; i < c.nitems; i++) {
+    if(!c.items[i].whole && !in_arena(t, c.items[i].node)) {
+      free(c.items[i].node);
+    }
+  }
+  free(c.items);
+
+  t->root = t->nil;
+  delete_rbtree(t);
+}
+
+// LSD radix sort는 key_t(32bit)를 8bit씩 4번 나누어 정렬
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES ((int)(sizeof(key_t) * 8) / RADIX_BITS)
+
+typedef struct {
+  key_t *src, *dst;
+  size_t n;
+  int nthreads;
+  int skip;
+  size_t (*hist)[RADIX_BUCKETS];
+  pthread_barrier_t barrier;
+  pthread_mutex_t start;  // 실제로 시작된 스레드 수가 정해질 때까지 worker를 붙잡아 둠
+} radix_ctx;
+
+typedef struct {
+  radix_ctx *ctx;
+  int id;
+} radix_arg;
+
+// 부호 비트를 뒤집어 음수가 양수보다 앞에 오도록 key의 shift 위치 digit을 반환
+// parameters : key_t k, int shift
+// return : digit
+static inline unsigned radix_digit(key_t k, int shift) {
+  return (((uint32_t)k ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// 스레드별 histogram을 (bucket, 스레드) 순서로 누적하여 scatter 시작 위치로 변환
+// 모든 key가 한 bucket에 몰리면 이번 pass는 건너뜀
+// parameters : radix_ctx c
+// return : void
+static void radix_offsets(radix_ctx *c) {
+  size_t sum = 0;
+
+  c->skip = 0;
+  for(int b = 0; b < RADIX_BUCKETS; b++) {
+    size_t total = 0;
+    for(int i = 0; i < c->nthreads; i++) {
+      total += c->hist[i][b];
+    }
+    if(total == c->n) {
+      c->skip = 1;
+      return;
+    }
+  }
+
+  for(int b = 0; b < RADIX_BUCKETS; b++) {
+    for(int i = 0; i < c->nthreads; i++) {
+      size_t cnt = c->hist[i][b];
+      c->hist[i][b] = sum;
+      sum += cnt;
+    }
+  }
+}
+
+// 자신이 맡은 구간에 대해 histogram -> offset -> scatter를 pass마다 반복
+// parameters : radix_arg
+// return : NULL
+static void *radix_worker(void *p) {
+  radix_arg *a = (radix_arg *)p;
+  radix_ctx *c = a->ctx;
+  size_t lo, hi, *h;
+
+  pthread_mutex_lock(&c->start);
+  pthread_mutex_unlock(&c->start);
+  lo = c->n * a->id / c->nthreads;
+  hi = c->n * (a->id + 1) / c->nthreads;
+  h = c->hist[a->id];
+
+  for(int pass = 0; pass < RADIX_PASSES; pass++) {
+    int shift = pass * RADIX_BITS;
+    key_t *src = c->src;
+
+    memset(h, 0, sizeof(c->hist[0]));
+    for(size_t i = lo; i < hi; i++) {
+      h[radix_digit(src[i], shift)]++;
+    }
+    pthread_barrier_wait(&c->barrier);
+
+    if(a->id == 0) {
+      radix_offsets(c);
+    }
+    pthread_barrier_wait(&c->barrier);
+
+    if(!c->skip) {
+      key_t *dst = c->dst;
+      for(size_t i = lo; i < hi; i++) {
+        dst[h[radix_digit(src[i], shift)]++] = src[i];
+      }
+    }
+    pthread_barrier_wait(&c->barrier);
+
+    if(a->id == 0 && !c->skip) {
+      c->src = c->dst;
+      c->dst = src;
+    }
+    pthread_barrier_wait(&c->barrier);
+  }
+
+  return NULL;
+}
+
+// key_t *keys를 최대 nthreads개의 스레드로 radix sort
+// 생성에 실패한 스레드가 있으면 시작된 스레드 수로 구간과 barrier를 정한 뒤 worker를 풀어 줌
+// 정렬 결과는 keys 또는 tmp 중 하나에 남으므로 그 포인터를 반환
+// parameters : key_t *keys, key_t *tmp, size_t n, int nthreads
+// return : 정렬된 배열, 실패 시 NULL
+static key_t *radix_sort_parallel(key_t *keys, key_t *tmp, const size_t n, int nthreads) {
+  radix_ctx c;
+  int spawned;
+  pthread_t *tids = (pthread_t *)calloc(nthreads, sizeof(pthread_t));
+  radix_arg *args = (radix_arg *)calloc(nthreads, sizeof(radix_arg));
+
+  c.src = keys;
+  c.dst = tmp;
+  c.n = n;
+  c.nthreads = nthreads;
+  c.skip = 0;
+  c.hist = calloc(nthreads, sizeof(c.hist[0]));
+
+  if(tids == NULL || args == NULL || c.hist == NULL) {
+    free(tids);
+    free(args);
+    free(c.hist);
+    return NULL;
+  }
+
+  for(int i = 0; i < nthreads; i++) {
+    args[i].ctx = &c;
+    args[i].id = i;
+  }
+  pthread_mutex_init(&c.start, NULL);
+  pthread_mutex_lock(&c.start);
+  for(spawned = 1; spawned < nthreads; spawned++) {
+    if(pthread_create(&tids[spawned], NULL, radix_worker, &args[spawned]) != 0) {
+      break;
+    }
+  }
+  c.nthreads = spawned;
+  pthread_barrier_init(&c.barrier, NULL, spawned);
+  pthread_mutex_unlock(&c.start);
+
+  radix_worker(&args[0]);
+  for(int i = 1; i < spawned; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  pthread_barrier_destroy(&c.barrier);
+  pthread_mutex_destroy(&c.start);
+
+  free(c.hist);
+  free(args);
+  free(tids);
+
+  return c.src;
+}
+
+typedef struct {
+  const key_t *keys;
+  node_t *nodes;
+  size_t n;
+  int depth, max_depth, spawn_depth;
+  node_t *nil;
+  node_t *root;
+} build_arg;
+
+static void *build_worker(void *p);
+
+// 정렬된 keys[0..n)로 완전 균형 서브트리를 만들어 루트를 반환
+// 가장 깊은 레벨의 노드만 red로 칠하면 모든 경로의 black 노드 수가 같아짐
+// spawn_depth보다 얕은 레벨에서는 왼쪽 서브트리를 새 스레드에서 만듦
+// parameters : build_arg a
+// return : 서브트리의 루트
+static node_t *build_subtree(build_arg *a) {
+  if(a->n == 0) {
+    return a->nil;
+  }
+
+  size_t mid = (a->n - 1) / 2;
+  node_t *node = &a->nodes[mid];
+
+  node->key = a->keys[mid];
+  node->color = (a->depth == a->max_depth && a->depth > 0) ? RBTREE_RED : RBTREE_BLACK;
+  node->parent = a->nil;
+
+  build_arg l = {a->keys, a->nodes, mid, a->depth + 1, a->max_depth, a->spawn_depth, a->nil, NULL};
+  build_arg r = {a->keys + mid + 1, a->nodes + mid + 1, a->n - mid - 1, a->depth + 1, a->max_depth,
+                 a->spawn_depth, a->nil, NULL};
+  pthread_t tid;
+  int spawned = 0;
+
+  if(a->depth < a->spawn_depth && l.n > 0) {
+    spawned = pthread_create(&tid, NULL, build_worker, &l) == 0;
+  }
+  if(!spawned) {
+    build_worker(&l);
+  }
+  build_worker(&r);
+  if(spawned) {
+    pthread_join(tid, NULL);
+  }
+
+  node->left = l.root;
+  node->right = r.root;
+  if(node->left != a->nil) {
+    node->left->parent = node;
+  }
+  if(node->right != a->nil) {
+    node->right->parent = node;
+  }
+
+  return node;
+}
+
+static void *build_worker(void *p) {
+  build_arg *a = (build_arg *)p;
+  a->root = build_subtree(a);
+  return NULL;
+}
+
+// 정렬된 key 배열로 균형 잡힌 rbtree를 bottom-up으로 생성
+// 노드는 하나의 slab에 key와 같은 순서로 놓이므로 노드마다 malloc하지 않음
+// 상위 log2(nthreads) 레벨에서 갈라진 서브트리들은 서로 다른 스레드가 만듦
+// parameters : key_t *keys (오름차순), size_t n, int nthreads
+// return : rbtree t, 실패 시 NULL
+rbtree *rbtree_from_sorted(const key_t *keys, const size_t n, int nthreads) {
+  rbtree *t = new_rbtree();
+  int max_depth = 0;
+  int spawn_depth = 0;
+
+  if(t == NULL) {
+    return NULL;
+  }
+  if(n <= RBTREE_SMALL_MAX) {
+    // 작은 트리는 small block에 넣어야 find가 key 배열을 쓸 수 있음
+    for(size_t i = 0; i < n; i++) {
+      if(rbtree_insert(t, keys[i]) == NULL) {
+        delete_rbtree(t);
+        return NULL;
+      }
+    }
+    return t;
+  }
+  nthreads = clamp_threads(nthreads);
+  while(((size_t)2 << max_depth) <= n) {
+    max_depth++;
+  }
+  while(((size_t)1 << spawn_depth) < (size_t)nthreads) {
+    spawn_depth++;
+  }
+  if(n > 0) {
+    struct rbtree_ext *e = ext_of(t);
+    if(e == NULL || (e->slabs = slab_new(n)) == NULL) {
+      delete_rbtree(t);
+      return NULL;
+    }
+    e->slabs->used = e->slabs->live = n;
+  }
+
+  build_arg a = {keys, n > 0 ? t->ext->slabs->nodes : NULL, n, 0, max_depth, spawn_depth,
+                 t->nil, NULL};
+  t->root = build_subtree(&a);
+  t->size = n;
+  t->leftmost = node_min(t, t->root);
+  t->rightmost = node_max(t, t->root);
+
+  return t;
+}
+
+// 정렬되지 않은 key 배열을 병렬 radix sort한 후 rbtree_from_sorted로 생성
+// 입력 배열은 수정하지 않음
+// parameters : key_t *keys, size_t n, int nthreads
+// return : rbtree t, 실패 시 NULL
+rbtree *rbtree_from_unsorted(const key_t *keys, const size_t n, int nthreads) {
+  key_t *buf = (key_t *)malloc((n + 1) * sizeof(key_t));
+  key_t *tmp = (key_t *)malloc((n + 1) * sizeof(key_t));
+  key_t *sorted;
+  rbtree *t = NULL;
+
+  nthreads = clamp_threads(nthreads);
+  if(buf != NULL && tmp != NULL) {
+    memcpy(buf, keys, n * sizeof(key_t));
+    sorted = radix_sort_parallel(buf, tmp, n, nthreads);
+    if(sorted != NULL) {
+      t = rbtree_from_sorted(sorted, n, nthreads);
+    }
+  }
+
+  free(tmp);
+  free(buf);
+
+  return t;
+}
@@ -7,19 +7,35 @@ typedef enum { RBTREE_RED, RBTREE_BLACK } color_t;
 
 typedef int key_t;
 
+// which key a full bounded tree gives up for a new one
+typedef enum { RBTREE_EVICT_MIN, RBTREE_EVICT_MAX, RBTREE_EVICT_OLDEST } evict_t;
+
 typedef struct node_t {
   color_t color;
   key_t key;
   struct node_t *parent, *left, *right;
 } node_t;
 
+struct rbtree_wal;
+struct rbtree_ext;
+struct rbtree_small;
+
 typedef struct {
   node_t *root;
-  node_t *nil;  // for sentinel
+  node_t *nil;  // for sentinel, shared by all trees
+  node_t *leftmost, *rightmost;  // cached min/max, nil when empty
+  size_t size;             // number of nodes
+  struct rbtree_wal *wal;  // write-ahead log, NULL unless durable
+  struct rbtree_ext *ext;  // state of optional modes, NULL until one is used
+  struct rbtree_small *small;  // sorted small-set block, NULL until the first insert
 } rbtree;
 
+typedef void (*rbtree_visit_t)(node_t *, size_t, void *);
+
 rbtree *new_rbtree(void);
+rbtree *new_rbtree_bounded(size_t, evict_t);
 void delete_rbtree(rbtree *);
+void delete_rbtree_parallel(rbtree *, int);
 
 node_t *rbtree_insert(rbtree *, const key_t);
 node_t *rbtree_find(const rbtree *, const key_t);
@@ -27,6 +43,23 @@ node_t *rbtree_min(const rbtree *);
 node_t *rbtree_max(const rbtree *);
 int rbtree_erase(rbtree *, node_t *);
 
+int rbtree_peek_min(const rbtree *, key_t *);
+int rbtree_peek_max(const rbtree *, key_t *);
+int rbtree_pop_min(rbtree *, key_t *);
+int rbtree_pop_max(rbtree *, key_t *);
+
+void rbtree_set_relaxed(rbtree *, int, size_t);
+size_t rbtree_rebalance(rbtree *, size_t);
+
+void rbtree_compact(rbtree *);
+int rbtree_compact_step(rbtree *, size_t);
+int rbtree_reserve(rbtree *, const size_t);
+
 int rbtree_to_array(const rbtree *, key_t *, const size_t);
+int rbtree_to_array_parallel(const rbtree *, key_t *, const size_t, int);
+int rbtree_foreach(const rbtree *, rbtree_visit_t, void *, int);
+
+rbtree *rbtree_from_sorted(const key_t *, const size_t, int);
+rbtree *rbtree_from_unsorted(const key_t *, const size_t, int);
 
 #endif  // _RBTREE_H_
@@ -0,0 +1,410 @@
+#include "rbtree_interval.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// interval rbtree 구조체 p를 할당하여 초기화 후 리턴
+// nil의 max는 INT_MIN이므로 자식이 없는 쪽은 max 계산에 영향을 주지 않음
+// parameters : void
+// return : interval_rbtree p
+interval_rbtree *new_rbtree_interval(void) {
+  interval_rbtree *p = (interval_rbtree *)calloc(1, sizeof(interval_rbtree));
+
+  if(p != NULL) {
+    interval_node_t *nil = (interval_node_t *)calloc(1, sizeof(interval_node_t));
+    if(nil != NULL) {
+      nil->color = RBTREE_BLACK;
+      nil->max = INT_MIN;
+      p->nil = nil;
+      p->root = p->nil;
+    }
+  }
+
+  return p;
+}
+
+// interval rbtree t의 모든 노드와 nil, t를 할당 해제
+// free_traverse와 같이 회전으로 트리를 펴 가면서 해제
+// parameters : interval_rbtree t
+// return : void
+void delete_rbtree_interval(interval_rbtree *t) {
+  interval_node_t *x = t->root;
+
+  while(x != t->nil) {
+    if(x->left == t->nil) {
+      interval_node_t *next = x->right;
+      free(x);
+      x = next;
+    } else {
+      interval_node_t *y = x->left;
+      x->left = y->right;
+      y->right = x;
+      x = y;
+    }
+  }
+  free(t->nil);
+  free(t);
+}
+
+// 노드 x의 max를 자신의 high와 두 자식의 max로부터 다시 계산
+// parameters : interval_node_t x
+// return : void
+static void update_max(interval_node_t *x) {
+  key_t m = x->high;
+
+  if(x->left->max > m) {
+    m = x->left->max;
+  }
+  if(x->right->max > m) {
+    m = x->right->max;
+  }
+  x->max = m;
+}
+
+// interval rbtree t에 대해 node_x를 기준으로 좌회전
+// 회전 후 아래로 내려간 x, 위로 올라온 y 순서로 max를 갱신
+// parameters : interval_rbtree t, interval_node_t node_x
+// return : void
+static void left_rotate(interval_rbtree *t, interval_node_t *node_x) {
+  interval_node_t *node_y = node_x->right;
+  node_x->right = node_y->left;
+
+  if(node_y->left != t->nil) {
+    node_y->left->parent = node_x;
+  }
+
+  node_y->parent = node_x->parent;
+
+  if(node_x->parent == t->nil) {
+    t->root = node_y;
+  } else if(node_x == node_x->parent->left) {
+    node_x->parent->left = node_y;
+  } else {
+    node_x->parent->right = node_y;
+  }
+
+  node_y->left = node_x;
+  node_x->parent = node_y;
+
+  update_max(node_x);
+  update_max(node_y);
+}
+
+// interval rbtree t에 대해 node_x를 기준으로 우회전
+// parameters : interval_rbtree t, interval_node_t node_x
+// return : void
+static void right_rotate(interval_rbtree *t, interval_node_t *node_x) {
+  interval_node_t *node_y = node_x->left;
+  node_x->left = node_y->right;
+
+  if(node_y->right != t->nil) {
+    node_y->right->parent = node_x;
+  }
+
+  node_y->parent = node_x->parent;
+
+  if(node_x->parent == t->nil) {
+    t->root = node_y;
+  } else if(node_x == node_x->parent->left) {
+    node_x->parent->left = node_y;
+  } else {
+    node_x->parent->right = node_y;
+  }
+
+  node_y->right = node_x;
+  node_x->parent = node_y;
+
+  update_max(node_x);
+  update_max(node_y);
+}
+
+// interval rbtree t에 대해 z 노드를 삽입한 후 rbtree 조건을 복구
+// max는 삽입 경로에서 이미 갱신되었고 회전에서만 다시 계산하면 됨
+// parameter : interval_rbtree t, interval_node_t z
+// return : void
+static void rb_insert_fixup(interval_rbtree *t, interval_node_t *z) {
+  while(z->parent->color == RBTREE_RED) {
+    interval_node_t *y = NULL;
+
+    if(z->parent == z->parent->parent->left) {
+      y = z->parent->parent->right;
+
+      if(y->color == RBTREE_RED) {
+        z->parent->color = RBTREE_BLACK;
+        y->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        z = z->parent->parent;
+      } else {
+        if(z == z->parent->right) {
+          z = z->parent;
+          left_rotate(t, z);
+        }
+        z->parent->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        right_rotate(t, z->parent->parent);
+      }
+    } else {
+      y = z->parent->parent->left;
+
+      if(y->color == RBTREE_RED) {
+        z->parent->color = RBTREE_BLACK;
+        y->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        z = z->parent->parent;
+      } else {
+        if(z == z->parent->left) {
+          z = z->parent;
+          right_rotate(t, z);
+        }
+        z->parent->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        left_rotate(t, z->parent->parent);
+      }
+    }
+  }
+  t->root->color = RBTREE_BLACK;
+}
+
+// interval rbtree t에 구간 [low, high]를 가지는 노드를 삽입
+// 내려가는 경로의 노드마다 max를 high로 끌어올림
+// low > high인 빈 구간은 max 불변식을 깨므로 받지 않음
+// parameters : interval_rbtree t, key_t low, key_t high
+// return : interval_node_t new_node, low > high이거나 할당 실패 시 NULL
+interval_node_t *rbtree_interval_insert(interval_rbtree *t, const key_t low, const key_t high) {
+  if(low > high) {
+    return NULL;
+  }
+  interval_node_t *new_node = (interval_node_t *)calloc(1, sizeof(interval_node_t));
+  if(new_node == NULL) {
+    return NULL;
+  }
+
+  new_node->color = RBTREE_RED;
+  new_node->low = low;
+  new_node->high = high;
+  new_node->max = high;
+  new_node->left = t->nil;
+  new_node->right = t->nil;
+
+  interval_node_t *node_y = t->nil;
+  interval_node_t *node_x = t->root;
+
+  while(node_x != t->nil) {
+    node_y = node_x;
+    if(node_x->max < high) {
+      node_x->max = high;
+    }
+
+    if(low < node_x->low) {
+      node_x = node_x->left;
+    } else {
+      node_x = node_x->right;
+    }
+  }
+
+  new_node->parent = node_y;
+
+  if(node_y == t->nil) {
+    t->root = new_node;
+  } else if(low < node_y->low) {
+    node_y->left = new_node;
+  } else {
+    node_y->right = new_node;
+  }
+
+  rb_insert_fixup(t, new_node);
+
+  return new_node;
+}
+
+// interval rbtree t에 대해 node_t u의 자리에 node_t v를 설정
+// parameters : interval_rbtree t, interval_node_t u, interval_node_t v
+// return : void
+static void rb_transplant(interval_rbtree *t, interval_node_t *u, interval_node_t *v) {
+  if(u->parent == t->nil) {
+    t->root = v;
+  } else if(u == u->parent->left) {
+    u->parent->left = v;
+  } else {
+    u->parent->right = v;
+  }
+  v->parent = u->parent;
+}
+
+// interval rbtree t에 대해 node_x가 있던 자리의 노드가 삭제됐을 때
+// rbtree 조건을 복구, max는 회전에서 다시 계산됨
+// parameters : interval_rbtree t, interval_node_t x
+// return : void
+static void rb_delete_fixup(interval_rbtree *t, interval_node_t *x) {
+  while(x != t->root && x->color == RBTREE_BLACK) {
+    interval_node_t *w = t->nil;
+
+    if(x == x->parent->left) {
+      w = x->parent->right;
+
+      if(w->color == RBTREE_RED) {
+        w->color = RBTREE_BLACK;
+        x->parent->color = RBTREE_RED;
+        left_rotate(t, x->parent);
+        w = x->parent->right;
+      }
+
+      if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
+        w->color = RBTREE_RED;
+        x = x->parent;
+      } else {
+        if(w->right->color == RBTREE_BLACK) {
+          w->left->color = RBTREE_BLACK;
+          w->color = RBTREE_RED;
+          right_rotate(t, w);
+          w = x->parent->right;
+        }
+
+        w->color = x->parent->color;
+        x->parent->color = RBTREE_BLACK;
+        w->right->color = RBTREE_BLACK;
+        left_rotate(t, x->parent);
+        x = t->root;
+      }
+    } else {
+      w = x->parent->left;
+
+      if(w->color == RBTREE_RED) {
+        w->color = RBTREE_BLACK;
+        x->parent->color = RBTREE_RED;
+        right_rotate(t, x->parent);
+        w = x->parent->left;
+      }
+
+      if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
+        w->color = RBTREE_RED;
+        x = x->parent;
+      } else {
+        if(w->left->color == RBTREE_BLACK) {
+          w->right->color = RBTREE_BLACK;
+          w->color = RBTREE_RED;
+          left_rotate(t, w);
+          w = x->parent->left;
+        }
+
+        w->color = x->parent->color;
+        x->parent->color = RBTREE_BLACK;
+        w->left->color = RBTREE_BLACK;
+        right_rotate(t, x->parent);
+        x = t->root;
+      }
+    }
+  }
+  x->color = RBTREE_BLACK;
+}
+
+// interval rbtree t에 대해 node p가 있다면 삭제
+// 노드가 빠진 위치부터 루트까지 max를 다시 계산한 뒤 색을 복구
+// parameters : interval_rbtree t, interval_node_t p
+// return : 성공 시 1, 실패 시 0
+int rbtree_interval_erase(interval_rbtree *t, interval_node_t *p) {
+  interval_node_t *y = p;
+  interval_node_t *x;
+  int y_origin_color;
+
+  if(p == NULL || p == t->nil) {
+    return 0;
+  }
+  y_origin_color = y->color;
+
+  if(p->left == t->nil) {
+    x = p->right;
+    rb_transplant(t, p, p->right);
+  } else if(p->right == t->nil) {
+    x = p->left;
+    rb_transplant(t, p, p->left);
+  } else {
+    y = p->right;
+    while(y->left != t->nil) {
+      y = y->left;
+    }
+    y_origin_color = y->color;
+    x = y->right;
+
+    if(y->parent == p) {
+      x->parent = y;
+    } else {
+      rb_transplant(t, y, y->right);
+      y->right = p->right;
+      y->right->parent = y;
+    }
+    rb_transplant(t, p, y);
+    y->left = p->left;
+    y->left->parent = y;
+    y->color = p->color;
+  }
+
+  for(interval_node_t *z = x->parent; z != t->nil; z = z->parent) {
+    update_max(z);
+  }
+
+  if(y_origin_color == RBTREE_BLACK) {
+    rb_delete_fixup(t, x);
+  }
+
+  free(p);
+
+  return 1;
+}
+
+// x를 루트로 하는 서브트리에서 [a, b]와 겹치는 구간마다 cb를 호출
+// max < a인 서브트리와 low > b인 노드의 오른쪽 서브트리는 건너뜀
+// parameters : interval_rbtree t, interval_node_t x, key_t a, key_t b, cb, arg
+// return : 찾은 구간 수
+static size_t overlap_traverse(const interval_rbtree *t, interval_node_t *x, const key_t a,
+                               const key_t b, rbtree_interval_cb cb, void *arg) {
+  size_t cnt = 0;
+
+  while(x != t->nil && x->max >= a) {
+    cnt += overlap_traverse(t, x->left, a, b, cb, arg);
+    if(x->low > b) {
+      break;
+    }
+    if(x->high >= a) {
+      if(cb != NULL) {
+        cb(x, arg);
+      }
+      cnt++;
+    }
+    x = x->right;
+  }
+
+  return cnt;
+}
+
+// interval rbtree t에서 닫힌 구간 [a, b]와 겹치는 모든 구간을 low 순서로 cb에 전달
+// parameters : interval_rbtree t, key_t a, key_t b, rbtree_interval_cb cb, void *arg
+// return : 찾은 구간 수
+size_t rbtree_interval_overlap(const interval_rbtree *t, const key_t a, const key_t b,
+                               rbtree_interval_cb cb, void *arg) {
+  if(a > b) {
+    return 0;
+  }
+  return overlap_traverse(t, t->root, a, b, cb, arg);
+}
+
+// interval rbtree t에서 point를 포함하는 구간 하나를 O(log n)에 검색
+// 왼쪽 서브트리의 max가 point 이상이면 답이 있다면 반드시 왼쪽에 있음
+// parameters : interval_rbtree t, key_t point
+// return : interval_node_t x or NULL
+interval_node_t *rbtree_interval_stab(const interval_rbtree *t, const key_t point) {
+  interval_node_t *x = t->root;
+
+  while(x != t->nil) {
+    if(x->low <= point && point <= x->high) {
+      return x;
+    }
+    if(x->left->max >= point) {
+      x = x->left;
+    } else {
+      x = x->right;
+    }
+  }
+
+  return NULL;
+}
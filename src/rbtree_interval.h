@@ -0,0 +1,33 @@
+#ifndef _RBTREE_INTERVAL_H_
+#define _RBTREE_INTERVAL_H_
+
+#include "rbtree.h"
+
+// closed interval [low, high] ordered by low
+// max is the largest high in the subtree rooted at this node
+typedef struct interval_node_t {
+  color_t color;
+  key_t low, high;
+  key_t max;
+  struct interval_node_t *parent, *left, *right;
+} interval_node_t;
+
+typedef struct {
+  interval_node_t *root;
+  interval_node_t *nil;  // for sentinel
+} interval_rbtree;
+
+typedef void (*rbtree_interval_cb)(interval_node_t *, void *);
+
+interval_rbtree *new_rbtree_interval(void);
+void delete_rbtree_interval(interval_rbtree *);
+
+// returns NULL without touching the tree when low > high
+interval_node_t *rbtree_interval_insert(interval_rbtree *, const key_t, const key_t);
+int rbtree_interval_erase(interval_rbtree *, interval_node_t *);
+
+size_t rbtree_interval_overlap(const interval_rbtree *, const key_t, const key_t,
+                               rbtree_interval_cb, void *);
+interval_node_t *rbtree_interval_stab(const interval_rbtree *, const key_t);
+
+#endif  // _RBTREE_INTERVAL_H_
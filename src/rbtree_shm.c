@@ -0,0 +1,695 @@
+#include "rbtree_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// segment 맨 앞에는 header가 있고, 그 안의 nil 노드는 항상 같은 offset에 있음
+// 노드는 header 뒤에 배열처럼 놓이며 모든 링크는 segment 시작으로부터의 offset
+// seq는 seqlock으로, writer가 수정하는 동안 홀수가 됨
+// writer는 segment를 만든 프로세스의 pid로, seq가 홀수인 채 멈췄을 때 reader가 생존을 확인
+typedef struct {
+  uint32_t magic;
+  _Atomic uint32_t seq;
+  int32_t writer;
+  uint64_t size, capacity, count;
+  shm_off_t root;
+  shm_off_t free_list;  // 해제된 노드, left로 연결
+  shm_off_t brk;        // 아직 한 번도 쓰지 않은 첫 노드
+  shm_node_t nil;
+} shm_header;
+
+#define SHM_MAGIC 0x324d5342u  // "BSM2"
+#define SHM_NIL ((shm_off_t)offsetof(shm_header, nil))
+#define SHM_FIRST ((shm_off_t)sizeof(shm_header))
+#define SHM_MAX_HEIGHT 128
+#define SHM_SPIN 64               // sched_yield 전에 바로 다시 읽는 횟수
+#define SHM_READ_LIMIT (1 << 16)  // 한 번의 읽기가 기다리는 최대 sched_yield 횟수
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield")
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+#define HDR(t) ((shm_header *)(t)->base)
+#define ND(x) ((shm_node_t *)(t->base + (x)))
+
+// name에 맨 앞 이외의 '/'가 있으면 파일, 아니면 POSIX shm 객체로 엶
+// parameters : char *name, int flags, mode_t mode
+// return : fd, 실패 시 -1
+static int shm_open_name(const char *name, int flags, mode_t mode) {
+  if(strchr(name + 1, '/') != NULL) {
+    return open(name, flags, mode);
+  }
+  return shm_open(name, flags, mode);
+}
+
+// capacity개의 노드를 담을 수 있는 segment를 새로 만들고 writer로 mapping
+// 같은 이름의 segment가 이미 있으면 실패 (reader가 mapping한 segment를 줄이면 SIGBUS가 나므로)
+// parameters : char *name, size_t capacity
+// return : shm_rbtree t, 실패 시 NULL
+shm_rbtree *rbtree_shm_create(const char *name, const size_t capacity) {
+  shm_rbtree *t = (shm_rbtree *)calloc(1, sizeof(shm_rbtree));
+  size_t size = SHM_FIRST + capacity * sizeof(shm_node_t);
+  int fd;
+
+  if(t == NULL) {
+    return NULL;
+  }
+  fd = shm_open_name(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if(fd < 0) {
+    free(t);
+    return NULL;
+  }
+  t->base = ftruncate(fd, size) != 0
+                ? MAP_FAILED
+                : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(t->base == MAP_FAILED) {
+    rbtree_shm_unlink(name);
+    free(t);
+    return NULL;
+  }
+  t->size = size;
+  t->writable = 1;
+
+  shm_header *h = HDR(t);
+  h->size = size;
+  h->capacity = capacity;
+  h->count = 0;
+  h->root = SHM_NIL;
+  h->free_list = SHM_NIL;
+  h->brk = SHM_FIRST;
+  h->writer = (int32_t)getpid();
+  h->nil.color = RBTREE_BLACK;
+  h->nil.parent = h->nil.left = h->nil.right = SHM_NIL;
+  atomic_store(&h->seq, 0);
+  atomic_thread_fence(memory_order_release);
+  h->magic = SHM_MAGIC;
+
+  return t;
+}
+
+// 이미 만들어진 segment를 reader로 읽기 전용 mapping (복사 없음)
+// parameters : char *name
+// return : shm_rbtree t, 실패 시 NULL
+shm_rbtree *rbtree_shm_open(const char *name) {
+  shm_rbtree *t = (shm_rbtree *)calloc(1, sizeof(shm_rbtree));
+  off_t size;
+  int fd;
+
+  if(t == NULL) {
+    return NULL;
+  }
+  fd = shm_open_name(name, O_RDONLY, 0);
+  size = fd < 0 ? -1 : lseek(fd, 0, SEEK_END);
+  if(size < (off_t)SHM_FIRST) {
+    if(fd >= 0) {
+      close(fd);
+    }
+    free(t);
+    return NULL;
+  }
+  t->base = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(t->base == MAP_FAILED) {
+    free(t);
+    return NULL;
+  }
+  t->size = (size_t)size;
+  if(HDR(t)->magic != SHM_MAGIC || HDR(t)->size != t->size) {
+    munmap(t->base, t->size);
+    free(t);
+    return NULL;
+  }
+
+  return t;
+}
+
+// mapping을 해제 (segment 자체는 남음)
+// parameters : shm_rbtree t
+// return : void
+void rbtree_shm_close(shm_rbtree *t) {
+  munmap(t->base, t->size);
+  free(t);
+}
+
+// segment를 삭제, 이미 mapping한 프로세스는 close할 때까지 계속 사용 가능
+// parameters : char *name
+// return : 성공 시 1, 실패 시 0
+int rbtree_shm_unlink(const char *name) {
+  if(strchr(name + 1, '/') != NULL) {
+    return unlink(name) == 0;
+  }
+  return shm_unlink(name) == 0;
+}
+
+// writer 수정 구간의 시작, seq를 홀수로 만들어 reader가 재시도하게 함
+static void write_begin(shm_header *h) {
+  uint32_t s = atomic_load_explicit(&h->seq, memory_order_relaxed);
+  atomic_store_explicit(&h->seq, s + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+// writer 수정 구간의 끝, seq를 다시 짝수로 만듦
+static void write_end(shm_header *h) {
+  uint32_t s = atomic_load_explicit(&h->seq, memory_order_relaxed);
+  atomic_store_explicit(&h->seq, s + 1, memory_order_release);
+}
+
+// seq가 홀수인 채로 writer 프로세스가 사라졌는지 확인
+static int writer_dead(const shm_header *h) {
+  return h->writer <= 0 || (kill((pid_t)h->writer, 0) != 0 && errno == ESRCH);
+}
+
+// reader 구간의 시작, writer가 수정 중이면 잠깐 spin한 뒤 sched_yield로 기다림
+// writer가 수정 도중 죽었거나 한 번의 읽기에서 기다린 횟수 *waits가 SHM_READ_LIMIT을 넘으면 포기
+// parameters : shm_header h, uint32_t *seq, unsigned *waits
+// return : 성공 시 1, 포기하면 0
+static int read_begin(const shm_header *h, uint32_t *seq, unsigned *waits) {
+  for(unsigned spin = 0;; spin++) {
+    *seq = atomic_load_explicit(&((shm_header *)h)->seq, memory_order_acquire);
+    if(!(*seq & 1)) {
+      return 1;
+    }
+    if(spin < SHM_SPIN) {
+      cpu_relax();
+      continue;
+    }
+    if(++*waits > SHM_READ_LIMIT || writer_dead(h)) {
+      return 0;
+    }
+    sched_yield();
+  }
+}
+
+// reader 구간 동안 writer가 수정했으면 1을 반환
+static int read_retry(const shm_header *h, uint32_t s) {
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&((shm_header *)h)->seq, memory_order_relaxed) != s;
+}
+
+// reader가 읽은 offset이 nil이거나 노드 배열 안의 올바른 위치인지 확인
+// writer와 겹쳐 읽은 쓰레기 값으로 segment 밖을 읽지 않기 위함
+static int valid_off(const shm_rbtree *t, shm_off_t x) {
+  return x == SHM_NIL ||
+         (x >= SHM_FIRST && x < t->size && (x - SHM_FIRST) % sizeof(shm_node_t) == 0);
+}
+
+// free list 또는 아직 안 쓴 영역에서 노드 하나를 할당
+// parameters : shm_rbtree t
+// return : 노드 offset, 공간이 없으면 SHM_NIL
+static shm_off_t node_alloc(shm_rbtree *t) {
+  shm_header *h = HDR(t);
+  shm_off_t x = h->free_list;
+
+  if(x != SHM_NIL) {
+    h->free_list = ND(x)->left;
+    return x;
+  }
+  if(h->brk + sizeof(shm_node_t) > h->size) {
+    return SHM_NIL;
+  }
+  x = h->brk;
+  h->brk += sizeof(shm_node_t);
+
+  return x;
+}
+
+// 노드를 free list에 반환
+static void node_free(shm_rbtree *t, shm_off_t x) {
+  shm_header *h = HDR(t);
+
+  ND(x)->left = h->free_list;
+  h->free_list = x;
+}
+
+// shm rbtree t에 대해 x를 기준으로 좌회전
+// parameters : shm_rbtree t, shm_off_t x
+// return : void
+static void left_rotate(shm_rbtree *t, shm_off_t x) {
+  shm_header *h = HDR(t);
+  shm_off_t y = ND(x)->right;
+  ND(x)->right = ND(y)->left;
+
+  if(ND(y)->left != SHM_NIL) {
+    ND(ND(y)->left)->parent = x;
+  }
+
+  ND(y)->parent = ND(x)->parent;
+
+  if(ND(x)->parent == SHM_NIL) {
+    h->root = y;
+  } else if(x == ND(ND(x)->parent)->left) {
+    ND(ND(x)->parent)->left = y;
+  } else {
+    ND(ND(x)->parent)->right = y;
+  }
+
+  ND(y)->left = x;
+  ND(x)->parent = y;
+}
+
+// shm rbtree t에 대해 x를 기준으로 우회전
+// parameters : shm_rbtree t, shm_off_t x
+// return : void
+static void right_rotate(shm_rbtree *t, shm_off_t x) {
+  shm_header *h = HDR(t);
+  shm_off_t y = ND(x)->left;
+  ND(x)->left = ND(y)->right;
+
+  if(ND(y)->right != SHM_NIL) {
+    ND(ND(y)->right)->parent = x;
+  }
+
+  ND(y)->parent = ND(x)->parent;
+
+  if(ND(x)->parent == SHM_NIL) {
+    h->root = y;
+  } else if(x == ND(ND(x)->parent)->left) {
+    ND(ND(x)->parent)->left = y;
+  } else {
+    ND(ND(x)->parent)->right = y;
+  }
+
+  ND(y)->right = x;
+  ND(x)->parent = y;
+}
+
+// shm rbtree t에 대해 z 노드를 삽입한 후 rbtree 조건을 복구
+// parameter : shm_rbtree t, shm_off_t z
+// return : void
+static void rb_insert_fixup(shm_rbtree *t, shm_off_t z) {
+  while(ND(ND(z)->parent)->color == RBTREE_RED) {
+    shm_off_t p = ND(z)->parent;
+    shm_off_t g = ND(p)->parent;
+    shm_off_t y;
+
+    if(p == ND(g)->left) {
+      y = ND(g)->right;
+
+      if(ND(y)->color == RBTREE_RED) {
+        ND(p)->color = RBTREE_BLACK;
+        ND(y)->color = RBTREE_BLACK;
+        ND(g)->color = RBTREE_RED;
+        z = g;
+      } else {
+        if(z == ND(p)->right) {
+          z = p;
+          left_rotate(t, z);
+        }
+        ND(ND(z)->parent)->color = RBTREE_BLACK;
+        ND(ND(ND(z)->parent)->parent)->color = RBTREE_RED;
+        right_rotate(t, ND(ND(z)->parent)->parent);
+      }
+    } else {
+      y = ND(g)->left;
+
+      if(ND(y)->color == RBTREE_RED) {
+        ND(p)->color = RBTREE_BLACK;
+        ND(y)->color = RBTREE_BLACK;
+        ND(g)->color = RBTREE_RED;
+        z = g;
+      } else {
+        if(z == ND(p)->left) {
+          z = p;
+          right_rotate(t, z);
+        }
+        ND(ND(z)->parent)->color = RBTREE_BLACK;
+        ND(ND(ND(z)->parent)->parent)->color = RBTREE_RED;
+        left_rotate(t, ND(ND(z)->parent)->parent);
+      }
+    }
+  }
+  ND(HDR(t)->root)->color = RBTREE_BLACK;
+}
+
+// shm rbtree t에 key를 삽입 (writer 전용)
+// parameters : shm_rbtree t, key_t key
+// return : 성공 시 1, segment가 가득 찼거나 읽기 전용이면 0
+int rbtree_shm_insert(shm_rbtree *t, const key_t key) {
+  shm_header *h = HDR(t);
+  shm_off_t z, x, y = SHM_NIL;
+
+  if(!t->writable) {
+    return 0;
+  }
+  write_begin(h);
+
+  z = node_alloc(t);
+  if(z == SHM_NIL) {
+    write_end(h);
+    return 0;
+  }
+  ND(z)->color = RBTREE_RED;
+  ND(z)->key = key;
+  ND(z)->left = SHM_NIL;
+  ND(z)->right = SHM_NIL;
+
+  x = h->root;
+  while(x != SHM_NIL) {
+    y = x;
+    x = key < ND(x)->key ? ND(x)->left : ND(x)->right;
+  }
+
+  ND(z)->parent = y;
+  if(y == SHM_NIL) {
+    h->root = z;
+  } else if(key < ND(y)->key) {
+    ND(y)->left = z;
+  } else {
+    ND(y)->right = z;
+  }
+
+  rb_insert_fixup(t, z);
+  h->count++;
+
+  write_end(h);
+
+  return 1;
+}
+
+// shm rbtree t에 대해 u의 자리에 v를 설정
+static void rb_transplant(shm_rbtree *t, shm_off_t u, shm_off_t v) {
+  if(ND(u)->parent == SHM_NIL) {
+    HDR(t)->root = v;
+  } else if(u == ND(ND(u)->parent)->left) {
+    ND(ND(u)->parent)->left = v;
+  } else {
+    ND(ND(u)->parent)->right = v;
+  }
+  ND(v)->parent = ND(u)->parent;
+}
+
+// shm rbtree t에 대해 x가 있던 자리의 노드가 삭제됐을 때 rbtree 조건을 복구
+// parameters : shm_rbtree t, shm_off_t x
+// return : void
+static void rb_delete_fixup(shm_rbtree *t, shm_off_t x) {
+  while(x != HDR(t)->root && ND(x)->color == RBTREE_BLACK) {
+    shm_off_t w;
+
+    if(x == ND(ND(x)->parent)->left) {
+      w = ND(ND(x)->parent)->right;
+
+      if(ND(w)->color == RBTREE_RED) {
+        ND(w)->color = RBTREE_BLACK;
+        ND(ND(x)->parent)->color = RBTREE_RED;
+        left_rotate(t, ND(x)->parent);
+        w = ND(ND(x)->parent)->right;
+      }
+
+      if(ND(ND(w)->left)->color == RBTREE_BLACK && ND(ND(w)->right)->color == RBTREE_BLACK) {
+        ND(w)->color = RBTREE_RED;
+        x = ND(x)->parent;
+      } else {
+        if(ND(ND(w)->right)->color == RBTREE_BLACK) {
+          ND(ND(w)->left)->color = RBTREE_BLACK;
+          ND(w)->color = RBTREE_RED;
+          right_rotate(t, w);
+          w = ND(ND(x)->parent)->right;
+        }
+
+        ND(w)->color = ND(ND(x)->parent)->color;
+        ND(ND(x)->parent)->color = RBTREE_BLACK;
+        ND(ND(w)->right)->color = RBTREE_BLACK;
+        left_rotate(t, ND(x)->parent);
+        x = HDR(t)->root;
+      }
+    } else {
+      w = ND(ND(x)->parent)->left;
+
+      if(ND(w)->color == RBTREE_RED) {
+        ND(w)->color = RBTREE_BLACK;
+        ND(ND(x)->parent)->color = RBTREE_RED;
+        right_rotate(t, ND(x)->parent);
+        w = ND(ND(x)->parent)->left;
+      }
+
+      if(ND(ND(w)->left)->color == RBTREE_BLACK && ND(ND(w)->right)->color == RBTREE_BLACK) {
+        ND(w)->color = RBTREE_RED;
+        x = ND(x)->parent;
+      } else {
+        if(ND(ND(w)->left)->color == RBTREE_BLACK) {
+          ND(ND(w)->right)->color = RBTREE_BLACK;
+          ND(w)->color = RBTREE_RED;
+          left_rotate(t, w);
+          w = ND(ND(x)->parent)->left;
+        }
+
+        ND(w)->color = ND(ND(x)->parent)->color;
+        ND(ND(x)->parent)->color = RBTREE_BLACK;
+        ND(ND(w)->left)->color = RBTREE_BLACK;
+        right_rotate(t, ND(x)->parent);
+        x = HDR(t)->root;
+      }
+    }
+  }
+  ND(x)->color = RBTREE_BLACK;
+}
+
+// shm rbtree t에서 key를 가지는 노드 하나를 삭제 (writer 전용)
+// parameters : shm_rbtree t, key_t key
+// return : 성공 시 1, 없거나 읽기 전용이면 0
+int rbtree_shm_erase(shm_rbtree *t, const key_t key) {
+  shm_header *h = HDR(t);
+  shm_off_t p = h->root, x, y;
+  int y_origin_color;
+
+  if(!t->writable) {
+    return 0;
+  }
+  while(p != SHM_NIL && ND(p)->key != key) {
+    p = key < ND(p)->key ? ND(p)->left : ND(p)->right;
+  }
+  if(p == SHM_NIL) {
+    return 0;
+  }
+
+  write_begin(h);
+
+  y = p;
+  y_origin_color = ND(y)->color;
+  if(ND(p)->left == SHM_NIL) {
+    x = ND(p)->right;
+    rb_transplant(t, p, ND(p)->right);
+  } else if(ND(p)->right == SHM_NIL) {
+    x = ND(p)->left;
+    rb_transplant(t, p, ND(p)->left);
+  } else {
+    y = ND(p)->right;
+    while(ND(y)->left != SHM_NIL) {
+      y = ND(y)->left;
+    }
+    y_origin_color = ND(y)->color;
+    x = ND(y)->right;
+
+    if(ND(y)->parent == p) {
+      ND(x)->parent = y;
+    } else {
+      rb_transplant(t, y, ND(y)->right);
+      ND(y)->right = ND(p)->right;
+      ND(ND(y)->right)->parent = y;
+    }
+    rb_transplant(t, p, y);
+    ND(y)->left = ND(p)->left;
+    ND(ND(y)->left)->parent = y;
+    ND(y)->color = ND(p)->color;
+  }
+
+  if(y_origin_color == RBTREE_BLACK) {
+    rb_delete_fixup(t, x);
+  }
+
+  node_free(t, p);
+  h->count--;
+
+  write_end(h);
+
+  return 1;
+}
+
+// seqlock 한 구간 동안 key를 검색
+// return : 있으면 1, 없으면 0, 일관성 없는 값을 읽었으면 -1
+static int find_once(const shm_rbtree *t, const key_t key) {
+  shm_off_t x = HDR(t)->root;
+
+  for(int depth = 0; depth < SHM_MAX_HEIGHT; depth++) {
+    if(!valid_off(t, x)) {
+      return -1;
+    }
+    if(x == SHM_NIL) {
+      return 0;
+    }
+    if(ND(x)->key == key) {
+      return 1;
+    }
+    x = key < ND(x)->key ? ND(x)->left : ND(x)->right;
+  }
+
+  return -1;
+}
+
+// shm rbtree t에 key가 있는지 검색
+// parameters : shm_rbtree t, key_t key
+// return : 있으면 1, 없으면 0, writer가 수정 도중 멈췄으면 -1
+int rbtree_shm_find(const shm_rbtree *t, const key_t key) {
+  uint32_t s;
+  unsigned waits = 0;
+  int r;
+
+  do {
+    if(!read_begin(HDR(t), &s, &waits)) {
+      return -1;
+    }
+    r = find_once(t, key);
+  } while(read_retry(HDR(t), s) || r < 0);
+
+  return r;
+}
+
+// seqlock 한 구간 동안 가장 왼쪽(dir 0) 또는 오른쪽(dir 1) key를 읽음
+// return : 있으면 1, 빈 트리면 0, 일관성 없는 값을 읽었으면 -1
+static int edge_once(const shm_rbtree *t, int dir, key_t *key) {
+  shm_off_t x = HDR(t)->root;
+
+  if(!valid_off(t, x)) {
+    return -1;
+  }
+  if(x == SHM_NIL) {
+    return 0;
+  }
+  for(int depth = 0; depth < SHM_MAX_HEIGHT; depth++) {
+    shm_off_t next = dir ? ND(x)->right : ND(x)->left;
+    if(!valid_off(t, next)) {
+      return -1;
+    }
+    if(next == SHM_NIL) {
+      *key = ND(x)->key;
+      return 1;
+    }
+    x = next;
+  }
+
+  return -1;
+}
+
+static int shm_edge(const shm_rbtree *t, int dir, key_t *key) {
+  uint32_t s;
+  unsigned waits = 0;
+  int r;
+
+  do {
+    if(!read_begin(HDR(t), &s, &waits)) {
+      return -1;
+    }
+    r = edge_once(t, dir, key);
+  } while(read_retry(HDR(t), s) || r < 0);
+
+  return r;
+}
+
+// shm rbtree t의 최소 key를 key_t *key에 저장
+// parameters : shm_rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0, writer가 수정 도중 멈췄으면 -1
+int rbtree_shm_min(const shm_rbtree *t, key_t *key) {
+  return shm_edge(t, 0, key);
+}
+
+// shm rbtree t의 최대 key를 key_t *key에 저장
+// parameters : shm_rbtree t, key_t *key
+// return : 성공 시 1, 빈 트리면 0, writer가 수정 도중 멈췄으면 -1
+int rbtree_shm_max(const shm_rbtree *t, key_t *key) {
+  return shm_edge(t, 1, key);
+}
+
+// seqlock 한 구간 동안 [lo, hi] 범위의 key를 최대 n개 arr에 기록
+// lo 이상인 첫 노드까지 내려간 뒤 parent 링크로 successor를 따라감
+// return : 기록한 개수, 일관성 없는 값을 읽었으면 -1
+static long range_once(const shm_rbtree *t, const key_t lo, const key_t hi, key_t *arr,
+                       const size_t n) {
+  shm_off_t x = HDR(t)->root, first = SHM_NIL;
+  size_t cnt = 0, steps = 0, limit = 2 * HDR(t)->capacity + SHM_MAX_HEIGHT;
+
+  for(int depth = 0; x != SHM_NIL; depth++) {
+    if(depth >= SHM_MAX_HEIGHT || !valid_off(t, x)) {
+      return -1;
+    }
+    if(ND(x)->key >= lo) {
+      first = x;
+      x = ND(x)->left;
+    } else {
+      x = ND(x)->right;
+    }
+  }
+
+  x = first;
+  while(x != SHM_NIL && cnt < n && ND(x)->key <= hi) {
+    arr[cnt++] = ND(x)->key;
+
+    if(ND(x)->right != SHM_NIL) {
+      x = ND(x)->right;
+      while(valid_off(t, x) && x != SHM_NIL && ND(x)->left != SHM_NIL && ++steps < limit) {
+        x = ND(x)->left;
+      }
+    } else {
+      shm_off_t y = ND(x)->parent;
+      while(valid_off(t, y) && y != SHM_NIL && x == ND(y)->right && ++steps < limit) {
+        x = y;
+        y = ND(y)->parent;
+      }
+      x = y;
+    }
+    if(!valid_off(t, x) || ++steps >= limit) {
+      return -1;
+    }
+  }
+
+  return (long)cnt;
+}
+
+// shm rbtree t에서 [lo, hi] 범위의 key를 오름차순으로 최대 n개 arr에 기록
+// parameters : shm_rbtree t, key_t lo, key_t hi, key_t *arr, size_t n
+// return : 기록한 개수, writer가 수정 도중 멈췄으면 SIZE_MAX
+size_t rbtree_shm_range(const shm_rbtree *t, const key_t lo, const key_t hi, key_t *arr,
+                        const size_t n) {
+  uint32_t s;
+  unsigned waits = 0;
+  long r;
+
+  do {
+    if(!read_begin(HDR(t), &s, &waits)) {
+      return SIZE_MAX;
+    }
+    r = range_once(t, lo, hi, arr, n);
+  } while(read_retry(HDR(t), s) || r < 0);
+
+  return (size_t)r;
+}
+
+// shm rbtree t의 노드 수
+// parameters : shm_rbtree t
+// return : 노드 수, writer가 수정 도중 멈췄으면 SIZE_MAX
+size_t rbtree_shm_size(const shm_rbtree *t) {
+  uint32_t s;
+  unsigned waits = 0;
+  size_t n;
+
+  do {
+    if(!read_begin(HDR(t), &s, &waits)) {
+      return SIZE_MAX;
+    }
+    n = HDR(t)->count;
+  } while(read_retry(HDR(t), s));
+
+  return n;
+}
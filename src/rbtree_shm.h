@@ -0,0 +1,45 @@
+#ifndef _RBTREE_SHM_H_
+#define _RBTREE_SHM_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+
+// offset of a node from the start of the shared segment
+typedef uint64_t shm_off_t;
+
+typedef struct {
+  color_t color;
+  key_t key;
+  shm_off_t parent, left, right;
+} shm_node_t;
+
+// process-local handle of a mapped segment
+typedef struct {
+  char *base;
+  size_t size;
+  int writable;
+} shm_rbtree;
+
+// name is a POSIX shm object ("/name") or, if it contains another '/',
+// a file path. capacity is the maximum number of nodes in the segment.
+// create fails if name already exists; unlink a stale segment first.
+shm_rbtree *rbtree_shm_create(const char *name, const size_t capacity);
+shm_rbtree *rbtree_shm_open(const char *name);
+void rbtree_shm_close(shm_rbtree *);
+int rbtree_shm_unlink(const char *name);
+
+// writer only
+int rbtree_shm_insert(shm_rbtree *, const key_t);
+int rbtree_shm_erase(shm_rbtree *, const key_t);
+
+// safe for read-only mappings while the writer is updating. a reader waits
+// a bounded time for an update in progress and reports an error (-1, or
+// SIZE_MAX for range/size) if the writer died mid-update or never finished.
+int rbtree_shm_find(const shm_rbtree *, const key_t);
+int rbtree_shm_min(const shm_rbtree *, key_t *);
+int rbtree_shm_max(const shm_rbtree *, key_t *);
+size_t rbtree_shm_range(const shm_rbtree *, const key_t, const key_t, key_t *, const size_t);
+size_t rbtree_shm_size(const shm_rbtree *);
+
+#endif  // _RBTREE_SHM_H_
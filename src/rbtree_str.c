@@ -0,0 +1,516 @@
+#include "rbtree_str.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// key 문자열을 이어 붙여 저장하는 chunk
+// 삭제된 key가 남긴 byte가 chunk 하나 이상이고 살아 있는 key보다 많아지면
+// 살아 있는 key만 새 chunk로 옮기고 옛 chunk를 해제 (arena_compact)
+#define STR_CHUNK_SIZE (64 * 1024)
+
+struct str_arena {
+  struct str_arena *next;
+  size_t used, cap;
+  char data[];
+};
+
+// chunk list를 모두 해제
+static void arena_free(struct str_arena *a) {
+  while(a != NULL) {
+    struct str_arena *next = a->next;
+    free(a);
+    a = next;
+  }
+}
+
+// 모든 string rbtree가 함께 쓰는 nil 노드 (어떤 연산도 쓰지 않음)
+static str_node_t str_nil = {RBTREE_BLACK, 0, 0, NULL, NULL, NULL, NULL};
+
+// string rbtree 구조체 p를 할당하여 초기화 후 리턴
+// parameters : void
+// return : str_rbtree p
+str_rbtree *new_rbtree_str(void) {
+  str_rbtree *p = (str_rbtree *)calloc(1, sizeof(str_rbtree));
+
+  if(p != NULL) {
+    p->nil = &str_nil;
+    p->root = p->nil;
+  }
+
+  return p;
+}
+
+// string rbtree t의 모든 노드와 key arena, t를 할당 해제
+// parameters : str_rbtree t
+// return : void
+void delete_rbtree_str(str_rbtree *t) {
+  str_node_t *x = t->root;
+
+  while(x != t->nil) {
+    if(x->left == t->nil) {
+      str_node_t *next = x->right;
+      free(x);
+      x = next;
+    } else {
+      str_node_t *y = x->left;
+      x->left = y->right;
+      y->right = x;
+      x = y;
+    }
+  }
+  arena_free(t->arena);
+  free(t);
+}
+
+// key의 앞 8byte를 big-endian 정수로 만듦 (짧으면 0으로 채움)
+// 이 정수의 대소가 앞 8byte의 사전순과 같음
+// parameters : char *key, size_t len
+// return : prefix
+static uint64_t str_prefix(const char *key, const size_t len) {
+  uint64_t p = 0;
+
+  for(size_t i = 0; i < 8; i++) {
+    p = (p << 8) | (i < len ? (unsigned char)key[i] : 0);
+  }
+
+  return p;
+}
+
+// (prefix, key, len)과 노드 x의 key를 사전순으로 비교
+// prefix가 다르면 정수 비교 한 번으로 끝나고, 같을 때만 9번째 byte부터 memcmp
+// parameters : uint64_t prefix, char *key, size_t len, str_node_t x
+// return : 작으면 음수, 같으면 0, 크면 양수
+static int str_cmp(const uint64_t prefix, const char *key, const size_t len, const str_node_t *x) {
+  if(prefix != x->prefix) {
+    return prefix < x->prefix ? -1 : 1;
+  }
+  if(len > 8 && x->len > 8) {
+    size_t m = (len < x->len ? len : x->len) - 8;
+    int c = memcmp(key + 8, x->key + 8, m);
+    if(c != 0) {
+      return c;
+    }
+  }
+
+  return (len > x->len) - (len < x->len);
+}
+
+// arena에 key를 복사하고 그 주소를 반환
+// 현재 chunk에 자리가 없으면 새 chunk를 앞에 추가 (큰 key는 전용 chunk)
+// parameters : str_rbtree t, char *key, size_t len
+// return : 복사된 key, 실패 시 NULL
+static const char *arena_copy(str_rbtree *t, const char *key, const size_t len) {
+  struct str_arena *a = t->arena;
+  char *dst;
+
+  if(a == NULL || a->cap - a->used < len) {
+    size_t cap = len > STR_CHUNK_SIZE ? len : STR_CHUNK_SIZE;
+    a = (struct str_arena *)malloc(sizeof(struct str_arena) + cap);
+    if(a == NULL) {
+      return NULL;
+    }
+    a->used = 0;
+    a->cap = cap;
+    a->next = t->arena;
+    t->arena = a;
+  }
+  dst = a->data + a->used;
+  memcpy(dst, key, len);
+  a->used += len;
+  t->live += len;
+
+  return dst;
+}
+
+// 살아 있는 key를 중위 순서로 한 chunk에 모아 복사하고 옛 chunk를 모두 해제
+// 복사량은 그 전까지 삭제된 byte 이하이므로 삭제 byte당 분할 상환 O(1)
+// 새 chunk를 할당하지 못하면 그대로 두고 다음 삭제에서 다시 시도
+// parameters : str_rbtree t
+// return : void
+static void arena_compact(str_rbtree *t) {
+  size_t cap = t->live > STR_CHUNK_SIZE ? t->live : STR_CHUNK_SIZE;
+  struct str_arena *a = (struct str_arena *)malloc(sizeof(struct str_arena) + cap);
+
+  if(a == NULL) {
+    return;
+  }
+  a->next = NULL;
+  a->used = 0;
+  a->cap = cap;
+  for(str_node_t *x = rbtree_str_first(t); x != NULL; x = rbtree_str_next(t, x)) {
+    memcpy(a->data + a->used, x->key, x->len);
+    x->key = a->data + a->used;
+    a->used += x->len;
+  }
+  arena_free(t->arena);
+  t->arena = a;
+  t->dead = 0;
+}
+
+// string rbtree t에 대해 node_x를 기준으로 좌회전
+// parameters : str_rbtree t, str_node_t node_x
+// return : void
+static void left_rotate(str_rbtree *t, str_node_t *node_x) {
+  str_node_t *node_y = node_x->right;
+  node_x->right = node_y->left;
+
+  if(node_y->left != t->nil) {
+    node_y->left->parent = node_x;
+  }
+
+  node_y->parent = node_x->parent;
+
+  if(node_x->parent == t->nil) {
+    t->root = node_y;
+  } else if(node_x == node_x->parent->left) {
+    node_x->parent->left = node_y;
+  } else {
+    node_x->parent->right = node_y;
+  }
+
+  node_y->left = node_x;
+  node_x->parent = node_y;
+}
+
+// string rbtree t에 대해 node_x를 기준으로 우회전
+// parameters : str_rbtree t, str_node_t node_x
+// return : void
+static void right_rotate(str_rbtree *t, str_node_t *node_x) {
+  str_node_t *node_y = node_x->left;
+  node_x->left = node_y->right;
+
+  if(node_y->right != t->nil) {
+    node_y->right->parent = node_x;
+  }
+
+  node_y->parent = node_x->parent;
+
+  if(node_x->parent == t->nil) {
+    t->root = node_y;
+  } else if(node_x == node_x->parent->left) {
+    node_x->parent->left = node_y;
+  } else {
+    node_x->parent->right = node_y;
+  }
+
+  node_y->right = node_x;
+  node_x->parent = node_y;
+}
+
+// string rbtree t에 대해 z 노드를 삽입한 후 rbtree 조건을 복구
+// parameter : str_rbtree t, str_node_t z
+// return : void
+static void rb_insert_fixup(str_rbtree *t, str_node_t *z) {
+  while(z->parent->color == RBTREE_RED) {
+    str_node_t *y = NULL;
+
+    if(z->parent == z->parent->parent->left) {
+      y = z->parent->parent->right;
+
+      if(y->color == RBTREE_RED) {
+        z->parent->color = RBTREE_BLACK;
+        y->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        z = z->parent->parent;
+      } else {
+        if(z == z->parent->right) {
+          z = z->parent;
+          left_rotate(t, z);
+        }
+        z->parent->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        right_rotate(t, z->parent->parent);
+      }
+    } else {
+      y = z->parent->parent->left;
+
+      if(y->color == RBTREE_RED) {
+        z->parent->color = RBTREE_BLACK;
+        y->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        z = z->parent->parent;
+      } else {
+        if(z == z->parent->left) {
+          z = z->parent;
+          right_rotate(t, z);
+        }
+        z->parent->color = RBTREE_BLACK;
+        z->parent->parent->color = RBTREE_RED;
+        left_rotate(t, z->parent->parent);
+      }
+    }
+  }
+  t->root->color = RBTREE_BLACK;
+}
+
+// string rbtree t에 key[0..len)을 복사하여 삽입 (같은 key가 있어도 하나 더 추가)
+// 노드를 먼저 할당하므로 실패해도 arena에 쓰이지 않는 key가 남지 않음
+// parameters : str_rbtree t, char *key, size_t len
+// return : str_node_t new_node, len이 UINT32_MAX보다 크거나 할당 실패 시 NULL
+str_node_t *rbtree_str_insert(str_rbtree *t, const char *key, const size_t len) {
+  str_node_t *new_node;
+  const char *copy;
+  uint64_t prefix;
+
+  if(len > UINT32_MAX) {
+    return NULL;
+  }
+  new_node = (str_node_t *)malloc(sizeof(str_node_t));
+  if(new_node == NULL) {
+    return NULL;
+  }
+  copy = arena_copy(t, key, len);
+  if(copy == NULL) {
+    free(new_node);
+    return NULL;
+  }
+  prefix = str_prefix(key, len);
+  new_node->color = RBTREE_RED;
+  new_node->len = (uint32_t)len;
+  new_node->prefix = prefix;
+  new_node->key = copy;
+  new_node->left = t->nil;
+  new_node->right = t->nil;
+
+  str_node_t *node_y = t->nil;
+  str_node_t *node_x = t->root;
+  int c = 0;
+
+  while(node_x != t->nil) {
+    node_y = node_x;
+    c = str_cmp(prefix, key, len, node_x);
+    node_x = (c < 0) ? node_x->left : node_x->right;
+  }
+
+  new_node->parent = node_y;
+
+  if(node_y == t->nil) {
+    t->root = new_node;
+  } else if(c < 0) {
+    node_y->left = new_node;
+  } else {
+    node_y->right = new_node;
+  }
+
+  rb_insert_fixup(t, new_node);
+
+  return new_node;
+}
+
+// string rbtree t에서 key와 같은 key를 가지는 노드를 검색
+// parameters : str_rbtree t, char *key, size_t len
+// return : str_node_t x or NULL
+str_node_t *rbtree_str_find(const str_rbtree *t, const char *key, const size_t len) {
+  uint64_t prefix = str_prefix(key, len);
+  str_node_t *x = t->root;
+
+  while(x != t->nil) {
+    int c = str_cmp(prefix, key, len, x);
+    if(c == 0) {
+      return x;
+    }
+    x = (c < 0) ? x->left : x->right;
+  }
+
+  return NULL;
+}
+
+// string rbtree t에서 key 이상인 첫 노드를 검색
+// parameters : str_rbtree t, char *key, size_t len
+// return : str_node_t x, 모든 key가 더 작으면 NULL
+str_node_t *rbtree_str_lower_bound(const str_rbtree *t, const char *key, const size_t len) {
+  uint64_t prefix = str_prefix(key, len);
+  str_node_t *x = t->root;
+  str_node_t *y = NULL;
+
+  while(x != t->nil) {
+    if(str_cmp(prefix, key, len, x) <= 0) {
+      y = x;
+      x = x->left;
+    } else {
+      x = x->right;
+    }
+  }
+
+  return y;
+}
+
+// string rbtree t에서 가장 작은 key의 노드
+// parameters : str_rbtree t
+// return : str_node_t x, 빈 트리면 NULL
+str_node_t *rbtree_str_first(const str_rbtree *t) {
+  str_node_t *x = t->root;
+
+  if(x == t->nil) {
+    return NULL;
+  }
+  while(x->left != t->nil) {
+    x = x->left;
+  }
+
+  return x;
+}
+
+// 중위 순서에서 x 다음 노드
+// parameters : str_rbtree t, str_node_t x
+// return : str_node_t, x가 마지막이면 NULL
+str_node_t *rbtree_str_next(const str_rbtree *t, const str_node_t *x) {
+  if(x->right != t->nil) {
+    x = x->right;
+    while(x->left != t->nil) {
+      x = x->left;
+    }
+    return (str_node_t *)x;
+  }
+
+  str_node_t *y = x->parent;
+  while(y != t->nil && x == y->right) {
+    x = y;
+    y = y->parent;
+  }
+
+  return y != t->nil ? y : NULL;
+}
+
+// string rbtree t에 대해 u의 자리에 v를 설정 (v가 nil이면 부모를 쓰지 않음)
+static void rb_transplant(str_rbtree *t, str_node_t *u, str_node_t *v) {
+  if(u->parent == t->nil) {
+    t->root = v;
+  } else if(u == u->parent->left) {
+    u->parent->left = v;
+  } else {
+    u->parent->right = v;
+  }
+  if(v != t->nil) {
+    v->parent = u->parent;
+  }
+}
+
+// string rbtree t에 대해 x가 있던 자리의 노드가 삭제됐을 때 rbtree 조건을 복구
+// nil은 공유되므로 x의 부모는 xp로 따로 받음
+// parameters : str_rbtree t, str_node_t x, str_node_t xp
+// return : void
+static void rb_delete_fixup(str_rbtree *t, str_node_t *x, str_node_t *xp) {
+  while(x != t->root && x->color == RBTREE_BLACK) {
+    str_node_t *w;
+
+    if(x == xp->left) {
+      w = xp->right;
+
+      if(w->color == RBTREE_RED) {
+        w->color = RBTREE_BLACK;
+        xp->color = RBTREE_RED;
+        left_rotate(t, xp);
+        w = xp->right;
+      }
+
+      if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
+        w->color = RBTREE_RED;
+        x = xp;
+        xp = x->parent;
+      } else {
+        if(w->right->color == RBTREE_BLACK) {
+          w->left->color = RBTREE_BLACK;
+          w->color = RBTREE_RED;
+          right_rotate(t, w);
+          w = xp->right;
+        }
+
+        w->color = xp->color;
+        xp->color = RBTREE_BLACK;
+        w->right->color = RBTREE_BLACK;
+        left_rotate(t, xp);
+        x = t->root;
+      }
+    } else {
+      w = xp->left;
+
+      if(w->color == RBTREE_RED) {
+        w->color = RBTREE_BLACK;
+        xp->color = RBTREE_RED;
+        right_rotate(t, xp);
+        w = xp->left;
+      }
+
+      if(w->left->color == RBTREE_BLACK && w->right->color == RBTREE_BLACK) {
+        w->color = RBTREE_RED;
+        x = xp;
+        xp = x->parent;
+      } else {
+        if(w->left->color == RBTREE_BLACK) {
+          w->right->color = RBTREE_BLACK;
+          w->color = RBTREE_RED;
+          left_rotate(t, w);
+          w = xp->left;
+        }
+
+        w->color = xp->color;
+        xp->color = RBTREE_BLACK;
+        w->left->color = RBTREE_BLACK;
+        right_rotate(t, xp);
+        x = t->root;
+      }
+    }
+  }
+  if(x != t->nil) {
+    x->color = RBTREE_BLACK;
+  }
+}
+
+// string rbtree t에서 노드 p를 삭제
+// key가 쓰던 arena 공간은 삭제된 byte가 쌓이면 arena_compact로 반환됨
+// parameters : str_rbtree t, str_node_t p
+// return : 성공 시 1, 실패 시 0
+int rbtree_str_erase(str_rbtree *t, str_node_t *p) {
+  str_node_t *y = p;
+  str_node_t *x, *xp;
+  int y_origin_color;
+
+  if(p == NULL || p == t->nil) {
+    return 0;
+  }
+  y_origin_color = y->color;
+
+  if(p->left == t->nil) {
+    x = p->right;
+    xp = p->parent;
+    rb_transplant(t, p, p->right);
+  } else if(p->right == t->nil) {
+    x = p->left;
+    xp = p->parent;
+    rb_transplant(t, p, p->left);
+  } else {
+    y = p->right;
+    while(y->left != t->nil) {
+      y = y->left;
+    }
+    y_origin_color = y->color;
+    x = y->right;
+
+    if(y->parent == p) {
+      xp = y;
+    } else {
+      xp = y->parent;
+      rb_transplant(t, y, y->right);
+      y->right = p->right;
+      y->right->parent = y;
+    }
+    rb_transplant(t, p, y);
+    y->left = p->left;
+    y->left->parent = y;
+    y->color = p->color;
+  }
+
+  if(y_origin_color == RBTREE_BLACK) {
+    rb_delete_fixup(t, x, xp);
+  }
+
+  t->live -= p->len;
+  t->dead += p->len;
+  free(p);
+  if(t->dead >= STR_CHUNK_SIZE && t->dead > t->live) {
+    arena_compact(t);
+  }
+
+  return 1;
+}
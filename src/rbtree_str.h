@@ -0,0 +1,41 @@
+#ifndef _RBTREE_STR_H_
+#define _RBTREE_STR_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+
+// string key node: the first 8 bytes are cached big-endian in prefix so most
+// comparisons during descent are a single integer compare
+typedef struct str_node_t {
+  color_t color;
+  uint32_t len;
+  uint64_t prefix;
+  const char *key;  // full key, owned by the tree's arena
+  struct str_node_t *parent, *left, *right;
+} str_node_t;
+
+struct str_arena;
+
+typedef struct {
+  str_node_t *root;
+  str_node_t *nil;  // for sentinel, shared by all string trees
+  struct str_arena *arena;
+  size_t live, dead;  // arena bytes held by current keys / left by erased keys
+} str_rbtree;
+
+str_rbtree *new_rbtree_str(void);
+void delete_rbtree_str(str_rbtree *);
+
+// keys longer than UINT32_MAX bytes are rejected with NULL
+str_node_t *rbtree_str_insert(str_rbtree *, const char *, const size_t);
+str_node_t *rbtree_str_find(const str_rbtree *, const char *, const size_t);
+str_node_t *rbtree_str_lower_bound(const str_rbtree *, const char *, const size_t);
+// may move the remaining keys to a fresh arena; re-read node->key afterwards
+int rbtree_str_erase(str_rbtree *, str_node_t *);
+
+// ordered iteration, NULL past the end
+str_node_t *rbtree_str_first(const str_rbtree *);
+str_node_t *rbtree_str_next(const str_rbtree *, const str_node_t *);
+
+#endif  // _RBTREE_STR_H_
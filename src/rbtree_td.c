@@ -0,0 +1,318 @@
+#include "rbtree_td.h"
+
+#include <stdlib.h>
+
+// parent 포인터 없이 내려가는 한 번의 경로에서 균형을 맞추는 top-down rbtree
+// 내려가면서 색 뒤집기와 회전을 미리 해 두므로 되돌아 올라가는 fixup이 필요 없음
+// 빈 자리는 nil 대신 NULL이고, NULL은 검은색으로 취급
+
+// 노드를 모아 할당하는 chunk
+// 노드마다 malloc하면 24byte 노드도 32byte를 차지하므로 chunk에서 잘라 씀
+// chunk 크기는 TD_CHUNK_MIN부터 2배씩 늘려 TD_CHUNK_MAX에서 멈춤
+#define TD_CHUNK_MIN 16
+#define TD_CHUNK_MAX 4096
+
+struct td_chunk {
+  struct td_chunk *next;
+  td_node_t nodes[];
+};
+
+// 노드 x가 빨간색인지 확인 (NULL은 검은색)
+// parameters : td_node_t x
+// return : 빨간색이면 1, 아니면 0
+static int is_red(const td_node_t *x) {
+  return x != NULL && x->color == RBTREE_RED;
+}
+
+// x를 dir 방향으로 한 번 회전하고 새 서브트리 루트를 리턴
+// 내려간 x는 빨간색, 올라온 노드는 검은색이 됨
+// parameters : td_node_t x, int dir
+// return : td_node_t y
+static td_node_t *rotate_single(td_node_t *x, const int dir) {
+  td_node_t *y = x->link[!dir];
+
+  x->link[!dir] = y->link[dir];
+  y->link[dir] = x;
+  x->color = RBTREE_RED;
+  y->color = RBTREE_BLACK;
+
+  return y;
+}
+
+// x의 !dir 자식을 !dir 방향으로 회전한 후 x를 dir 방향으로 회전
+// parameters : td_node_t x, int dir
+// return : td_node_t y
+static td_node_t *rotate_double(td_node_t *x, const int dir) {
+  x->link[!dir] = rotate_single(x->link[!dir], !dir);
+  return rotate_single(x, dir);
+}
+
+// t의 chunk를 모두 해제
+// parameters : td_rbtree t
+// return : void
+static void chunks_free(td_rbtree *t) {
+  while(t->chunks != NULL) {
+    struct td_chunk *c = t->chunks;
+    t->chunks = c->next;
+    free(c);
+  }
+  t->free = NULL;
+  t->cap = 0;
+}
+
+// 노드 n개짜리 chunk를 할당하여 모든 칸을 free list 앞에 넣음
+// parameters : td_rbtree t, size_t n
+// return : 성공 시 1, 할당 실패 시 0
+static int chunk_add(td_rbtree *t, const size_t n) {
+  struct td_chunk *c = (struct td_chunk *)malloc(sizeof(struct td_chunk) + n * sizeof(td_node_t));
+
+  if(c == NULL) {
+    return 0;
+  }
+  c->next = t->chunks;
+  t->chunks = c;
+  t->cap += n;
+  for(size_t i = 0; i < n; i++) {
+    c->nodes[i].link[0] = i + 1 < n ? &c->nodes[i + 1] : t->free;
+  }
+  t->free = c->nodes;
+
+  return 1;
+}
+
+// 새 노드 하나를 free list에서 꺼냄, 비어 있으면 chunk를 하나 더 할당하여 채움
+// parameters : td_rbtree t
+// return : td_node_t x, 할당 실패 시 NULL
+static td_node_t *node_alloc(td_rbtree *t) {
+  td_node_t *x;
+
+  if(t->free == NULL &&
+     !chunk_add(t, t->cap < TD_CHUNK_MIN ? TD_CHUNK_MIN : t->cap < TD_CHUNK_MAX ? t->cap : TD_CHUNK_MAX)) {
+    return NULL;
+  }
+  x = t->free;
+  t->free = x->link[0];
+
+  return x;
+}
+
+// 노드 x를 free list에 돌려 놓음, 트리가 비면 chunk를 모두 해제
+// parameters : td_rbtree t, td_node_t x
+// return : void
+static void node_free(td_rbtree *t, td_node_t *x) {
+  if(t->size == 0) {
+    chunks_free(t);
+    return;
+  }
+  x->link[0] = t->free;
+  t->free = x;
+}
+
+// top-down rbtree 구조체 p를 할당하여 초기화 후 리턴
+// parameters : void
+// return : td_rbtree p
+td_rbtree *new_rbtree_td(void) {
+  return (td_rbtree *)calloc(1, sizeof(td_rbtree));
+}
+
+// 노드 n개를 담는 chunk 하나를 미리 할당 (TD_CHUNK_MAX 제한 없음)
+// parameters : td_rbtree t, size_t n
+// return : 성공 시 1, 실패 시 0
+int rbtree_td_reserve(td_rbtree *t, const size_t n) {
+  return n > 0 && chunk_add(t, n);
+}
+
+// top-down rbtree t의 모든 노드와 t를 할당 해제
+// 노드는 모두 chunk에 있으므로 트리를 순회하지 않고 chunk만 해제
+// parameters : td_rbtree t
+// return : void
+void delete_rbtree_td(td_rbtree *t) {
+  chunks_free(t);
+  free(t);
+}
+
+// top-down rbtree t에 key를 가지는 노드를 삽입
+// 경로 위에서 두 자식이 모두 빨간 노드를 만나면 색을 뒤집고,
+// 그로 인해 생긴 red-red는 증조부모에서 바로 회전하여 해결
+// 같은 key는 rbtree_insert와 같이 오른쪽으로 보냄
+// parameters : td_rbtree t, key_t key
+// return : td_node_t new_node, 할당 실패 시 NULL
+td_node_t *rbtree_td_insert(td_rbtree *t, const key_t key) {
+  td_node_t *new_node = node_alloc(t);
+  td_node_t head = {{NULL, NULL}, 0, RBTREE_BLACK};  // 루트 위의 가짜 노드
+  td_node_t *g = NULL, *p = NULL, *q, *gg = &head;
+  int dir = 1, last = 1;
+
+  if(new_node == NULL) {
+    return NULL;
+  }
+  new_node->link[0] = new_node->link[1] = NULL;
+  new_node->key = key;
+  new_node->color = RBTREE_RED;
+
+  if(t->root == NULL) {
+    new_node->color = RBTREE_BLACK;
+    t->root = new_node;
+    t->size++;
+    return new_node;
+  }
+
+  head.link[1] = t->root;
+  q = t->root;
+  for(;;) {
+    if(q == NULL) {
+      p->link[dir] = q = new_node;
+    } else if(is_red(q->link[0]) && is_red(q->link[1])) {
+      q->color = RBTREE_RED;
+      q->link[0]->color = RBTREE_BLACK;
+      q->link[1]->color = RBTREE_BLACK;
+    }
+
+    if(is_red(q) && is_red(p)) {
+      int dir2 = gg->link[1] == g;
+      if(q == p->link[last]) {
+        gg->link[dir2] = rotate_single(g, !last);
+      } else {
+        gg->link[dir2] = rotate_double(g, !last);
+      }
+    }
+
+    if(q == new_node) {
+      break;
+    }
+    last = dir;
+    dir = key >= q->key;
+    if(g != NULL) {
+      gg = g;
+    }
+    g = p;
+    p = q;
+    q = q->link[dir];
+  }
+
+  t->root = head.link[1];
+  t->root->color = RBTREE_BLACK;
+  t->size++;
+
+  return new_node;
+}
+
+// top-down rbtree t에서 key를 가지는 노드를 검색
+// parameters : td_rbtree t, key_t key
+// return : td_node_t x or NULL
+td_node_t *rbtree_td_find(const td_rbtree *t, const key_t key) {
+  td_node_t *x = t->root;
+
+  while(x != NULL && x->key != key) {
+    x = x->link[key > x->key];
+  }
+
+  return x;
+}
+
+// top-down rbtree t에서 key를 가지는 노드 하나를 삭제
+// 내려가는 동안 현재 노드가 항상 빨간색이 되도록 색을 밀어 내리므로
+// 경로 끝의 노드는 자식 없는 빨간 노드가 되어 바로 떼어낼 수 있음
+// 찾은 노드에는 경로 끝 노드(in-order 직전 노드)의 key를 복사
+// parameters : td_rbtree t, key_t key
+// return : 성공 시 1, 실패 시 0
+int rbtree_td_erase(td_rbtree *t, const key_t key) {
+  td_node_t head = {{NULL, NULL}, 0, RBTREE_BLACK};
+  td_node_t *q = &head, *p = NULL, *g = NULL, *found = NULL;
+  int dir = 1;
+
+  if(t->root == NULL) {
+    return 0;
+  }
+  head.link[1] = t->root;
+
+  while(q->link[dir] != NULL) {
+    int last = dir;
+
+    g = p;
+    p = q;
+    q = q->link[dir];
+    dir = q->key < key;
+    if(q->key == key) {
+      found = q;
+    }
+
+    if(!is_red(q) && !is_red(q->link[dir])) {
+      if(is_red(q->link[!dir])) {
+        p = p->link[last] = rotate_single(q, dir);
+      } else {
+        td_node_t *s = p->link[!last];
+
+        if(s != NULL) {
+          if(!is_red(s->link[0]) && !is_red(s->link[1])) {
+            p->color = RBTREE_BLACK;
+            s->color = RBTREE_RED;
+            q->color = RBTREE_RED;
+          } else {
+            int dir2 = g->link[1] == p;
+
+            if(is_red(s->link[last])) {
+              g->link[dir2] = rotate_double(p, last);
+            } else {
+              g->link[dir2] = rotate_single(p, last);
+            }
+            q->color = RBTREE_RED;
+            g->link[dir2]->color = RBTREE_RED;
+            g->link[dir2]->link[0]->color = RBTREE_BLACK;
+            g->link[dir2]->link[1]->color = RBTREE_BLACK;
+          }
+        }
+      }
+    }
+  }
+
+  if(found != NULL) {
+    found->key = q->key;
+    p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
+    t->size--;
+    node_free(t, q);
+  }
+  t->root = head.link[1];
+  if(t->root != NULL) {
+    t->root->color = RBTREE_BLACK;
+  }
+
+  return found != NULL;
+}
+
+// x부터 왼쪽 끝까지의 경로를 it의 스택에 쌓음
+// parameters : td_iter it, td_node_t x
+// return : void
+static void iter_push_left(td_iter *it, td_node_t *x) {
+  while(x != NULL) {
+    it->path[it->top++] = x;
+    x = x->link[0];
+  }
+}
+
+// top-down rbtree t의 in-order 순회를 it로 시작하고 최솟값 노드를 리턴
+// parameters : td_rbtree t, td_iter it
+// return : td_node_t x, 빈 트리면 NULL
+td_node_t *rbtree_td_first(const td_rbtree *t, td_iter *it) {
+  it->top = 0;
+  iter_push_left(it, t->root);
+
+  return it->top > 0 ? it->path[it->top - 1] : NULL;
+}
+
+// it가 가리키는 노드의 다음 노드로 이동
+// 스택의 맨 위가 현재 노드이며, 오른쪽 서브트리가 없으면 스택에서 꺼내는 것으로 부모로 돌아감
+// 순회 도중 트리를 변경하면 it는 무효가 됨
+// parameters : td_iter it
+// return : td_node_t x, 끝이면 NULL
+td_node_t *rbtree_td_next(td_iter *it) {
+  td_node_t *x;
+
+  if(it->top == 0) {
+    return NULL;
+  }
+  x = it->path[--it->top];
+  iter_push_left(it, x->link[1]);
+
+  return it->top > 0 ? it->path[it->top - 1] : NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef _RBTREE_TD_H_
+#define _RBTREE_TD_H_
+
+#include "rbtree.h"
+
+// node without a parent pointer: 24 bytes instead of the 32 of node_t
+// nodes are carved from per-tree chunks, so 24 bytes is also what malloc hands out
+// link[0] is the left child, link[1] the right child, NULL for leaves
+typedef struct td_node_t {
+  struct td_node_t *link[2];
+  key_t key;
+  color_t color;
+} td_node_t;
+
+struct td_chunk;
+
+typedef struct {
+  td_node_t *root;
+  size_t size;
+  struct td_chunk *chunks;  // node storage, newest first
+  td_node_t *free;          // unused nodes of chunks, linked through link[0]
+  size_t cap;               // number of nodes in chunks
+} td_rbtree;
+
+// enough for any red-black tree with fewer than 2^64 nodes
+#define TD_HEIGHT_LIMIT 128
+
+// in-order iterator; the stack replaces the parent links
+typedef struct {
+  td_node_t *path[TD_HEIGHT_LIMIT];
+  size_t top;
+} td_iter;
+
+td_rbtree *new_rbtree_td(void);
+void delete_rbtree_td(td_rbtree *);
+int rbtree_td_reserve(td_rbtree *, const size_t);
+
+td_node_t *rbtree_td_insert(td_rbtree *, const key_t);
+td_node_t *rbtree_td_find(const td_rbtree *, const key_t);
+int rbtree_td_erase(td_rbtree *, const key_t);
+
+td_node_t *rbtree_td_first(const td_rbtree *, td_iter *);
+td_node_t *rbtree_td_next(td_iter *);
+
+#endif  // _RBTREE_TD_H_
@@ -0,0 +1,387 @@
+#include "rbtree_wal.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// log 파일은 8byte header(magic, generation) 뒤에 9byte record(op, key, crc)가 이어짐
+// crc는 op와 key의 CRC-32
+// checkpoint 파일은 16byte header(magic, generation, 개수) 뒤에 정렬된 key가 이어짐
+// checkpoint의 generation은 그 snapshot이 이미 반영한 log의 generation
+#define WAL_MAGIC 0x4c575242u   // "RBWL"
+#define CKPT_MAGIC 0x4b435242u  // "RBCK"
+#define WAL_RECORD_SIZE (1 + sizeof(key_t) + sizeof(uint32_t))
+#define WAL_BUF_SIZE (64 * 1024)
+
+struct rbtree_wal {
+  int fd;
+  char *log_path, *ckpt_path, *dir_path;
+  uint32_t gen;
+  int group;
+  size_t checkpoint_every;
+  size_t pending;  // 마지막 fsync 이후의 record 수
+  size_t logged;   // 마지막 checkpoint 이후의 record 수
+  int failed;
+  size_t len;
+  unsigned char buf[WAL_BUF_SIZE];
+};
+
+// fd에 buf의 len byte를 모두 기록
+// parameters : int fd, void *buf, size_t len
+// return : 성공 시 1, 실패 시 0
+static int write_all(int fd, const void *buf, size_t len) {
+  const unsigned char *p = (const unsigned char *)buf;
+
+  while(len > 0) {
+    ssize_t w = write(fd, p, len);
+    if(w < 0) {
+      return 0;
+    }
+    p += w;
+    len -= (size_t)w;
+  }
+
+  return 1;
+}
+
+// path 파일 전체를 읽어 새로 할당한 버퍼로 반환
+// parameters : char *path, size_t *len
+// return : 버퍼, 파일이 없거나 실패 시 NULL
+static unsigned char *read_all(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  off_t size;
+  unsigned char *buf;
+  size_t got = 0;
+
+  if(fd < 0) {
+    return NULL;
+  }
+  size = lseek(fd, 0, SEEK_END);
+  lseek(fd, 0, SEEK_SET);
+  buf = (unsigned char *)malloc(size > 0 ? (size_t)size : 1);
+  while(buf != NULL && got < (size_t)size) {
+    ssize_t r = read(fd, buf + got, (size_t)size - got);
+    if(r <= 0) {
+      break;
+    }
+    got += (size_t)r;
+  }
+  close(fd);
+  *len = got;
+
+  return buf;
+}
+
+// path가 들어 있는 디렉터리를 fsync하여 rename을 영속화
+// parameters : char *dir
+// return : void
+static void sync_dir(const char *dir) {
+  int fd = open(dir, O_RDONLY);
+
+  if(fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+// buf의 len byte에 대한 CRC-32 (IEEE, reflected)
+// parameters : void *buf, size_t len
+// return : crc
+static uint32_t crc32(const void *buf, size_t len) {
+  const unsigned char *p = (const unsigned char *)buf;
+  uint32_t crc = 0xffffffffu;
+
+  while(len-- > 0) {
+    crc ^= *p++;
+    for(int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+    }
+  }
+
+  return ~crc;
+}
+
+// 버퍼에 모인 record를 log 파일에 쓰고, sync가 1이면 fsync까지 수행
+// parameters : rbtree_wal w, int sync
+// return : 성공 시 1, 실패 시 0
+static int wal_flush(struct rbtree_wal *w, int sync) {
+  if(w->len > 0) {
+    if(!write_all(w->fd, w->buf, w->len)) {
+      w->failed = 1;
+    }
+    w->len = 0;
+  }
+  if(sync && w->pending > 0) {
+    if(fsync(w->fd) != 0) {
+      w->failed = 1;
+    }
+    w->pending = 0;
+  }
+
+  return !w->failed;
+}
+
+// log 파일을 비우고 generation gen의 header를 기록
+// parameters : rbtree_wal w, uint32_t gen
+// return : 성공 시 1, 실패 시 0
+static int wal_reset(struct rbtree_wal *w, uint32_t gen) {
+  uint32_t header[2] = {WAL_MAGIC, gen};
+
+  if(ftruncate(w->fd, 0) != 0 || !write_all(w->fd, header, sizeof(header)) ||
+     fsync(w->fd) != 0) {
+    w->failed = 1;
+    return 0;
+  }
+  w->gen = gen;
+  w->len = 0;
+  w->pending = 0;
+  w->logged = 0;
+
+  return 1;
+}
+
+// rbtree t에 적용하기 전의 변경 record 하나를 log 버퍼에 추가
+// group개가 모이면 한 번의 fsync로 함께 commit
+// log가 한 번 실패하면 더 이상 record를 받지 않음
+// parameters : rbtree t, char op, key_t key
+// return : 성공 시 1, 실패 시 0 (호출한 쪽은 변경을 적용하지 않아야 함)
+int rbtree_wal_append(rbtree *t, const char op, const key_t key) {
+  struct rbtree_wal *w = t->wal;
+  unsigned char *r;
+  uint32_t crc;
+
+  if(w->failed) {
+    return 0;
+  }
+  if(w->len + WAL_RECORD_SIZE > WAL_BUF_SIZE && !wal_flush(w, 0)) {
+    return 0;
+  }
+  r = w->buf + w->len;
+  r[0] = (unsigned char)op;
+  memcpy(r + 1, &key, sizeof(key_t));
+  crc = crc32(r, 1 + sizeof(key_t));
+  memcpy(r + 1 + sizeof(key_t), &crc, sizeof(crc));
+  w->len += WAL_RECORD_SIZE;
+  w->pending++;
+  w->logged++;
+
+  if(w->pending >= (size_t)w->group) {
+    wal_flush(w, 1);
+  }
+
+  return !w->failed;
+}
+
+// 기록한 변경을 트리에 적용한 후 호출, log가 길어졌으면 checkpoint
+// parameters : rbtree t
+// return : void
+void rbtree_wal_applied(rbtree *t) {
+  struct rbtree_wal *w = t->wal;
+
+  if(w->checkpoint_every > 0 && w->logged >= w->checkpoint_every) {
+    rbtree_checkpoint(t);
+  }
+}
+
+// log 쓰기나 fsync가 실패하여 변경을 더 받을 수 없는 상태인지 확인
+// parameters : rbtree_wal w
+// return : 실패한 상태면 1, 아니면 0
+int rbtree_wal_failed(const struct rbtree_wal *w) {
+  return w->failed;
+}
+
+// 아직 commit되지 않은 record를 log에 쓰고 fsync
+// parameters : rbtree t
+// return : 성공 시 1, 실패 시 0
+int rbtree_sync(rbtree *t) {
+  if(t->wal == NULL) {
+    return 0;
+  }
+  return wal_flush(t->wal, 1);
+}
+
+// rbtree t의 정렬된 snapshot을 임시 파일에 쓴 후 rename으로 교체하고 log를 비움
+// rename과 log 초기화 사이에 죽더라도 generation 비교로 log가 중복 적용되지 않음
+// parameters : rbtree t
+// return : 성공 시 1, 실패 시 0
+int rbtree_checkpoint(rbtree *t) {
+  struct rbtree_wal *w = t->wal;
+  size_t n = t->size;
+  key_t *keys;
+  char *tmp_path;
+  int fd, ok = 0;
+
+  if(w == NULL) {
+    return 0;
+  }
+  keys = (key_t *)malloc((n + 1) * sizeof(key_t));
+  tmp_path = (char *)malloc(strlen(w->ckpt_path) + 5);
+  if(keys == NULL || tmp_path == NULL) {
+    free(keys);
+    free(tmp_path);
+    return 0;
+  }
+  rbtree_to_array(t, keys, n);
+  sprintf(tmp_path, "%s.tmp", w->ckpt_path);
+
+  fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd >= 0) {
+    uint32_t header[2] = {CKPT_MAGIC, w->gen};
+    uint64_t count = n;
+    ok = write_all(fd, header, sizeof(header)) && write_all(fd, &count, sizeof(count)) &&
+         write_all(fd, keys, n * sizeof(key_t)) && fsync(fd) == 0;
+    close(fd);
+  }
+  if(ok) {
+    ok = rename(tmp_path, w->ckpt_path) == 0;
+    sync_dir(w->dir_path);
+  }
+  if(ok) {
+    ok = wal_reset(w, w->gen + 1);
+  }
+
+  free(tmp_path);
+  free(keys);
+
+  return ok;
+}
+
+// 남은 record를 commit하고 log 파일을 닫음 (delete_rbtree에서 호출)
+// parameters : rbtree_wal w
+// return : void
+void rbtree_wal_close(struct rbtree_wal *w) {
+  wal_flush(w, 1);
+  close(w->fd);
+  free(w->log_path);
+  free(w->ckpt_path);
+  free(w->dir_path);
+  free(w);
+}
+
+// checkpoint를 읽어 rbtree를 만들고 generation을 *gen에 저장
+// parameters : char *path, uint32_t *gen
+// return : rbtree t, 실패 시 NULL
+static rbtree *load_checkpoint(const char *path, uint32_t *gen) {
+  size_t len = 0;
+  unsigned char *buf = read_all(path, &len);
+  uint32_t header[2];
+  uint64_t count;
+  rbtree *t;
+
+  *gen = 0;
+  if(buf == NULL) {
+    return new_rbtree();
+  }
+  if(len < sizeof(header) + sizeof(count)) {
+    free(buf);
+    return NULL;
+  }
+  memcpy(header, buf, sizeof(header));
+  memcpy(&count, buf + sizeof(header), sizeof(count));
+  if(header[0] != CKPT_MAGIC || len < sizeof(header) + sizeof(count) + count * sizeof(key_t)) {
+    free(buf);
+    return NULL;
+  }
+  *gen = header[1];
+  t = rbtree_from_sorted((const key_t *)(buf + sizeof(header) + sizeof(count)), count, 1);
+  free(buf);
+
+  return t;
+}
+
+// log의 generation이 checkpoint보다 새로우면 record를 순서대로 다시 적용
+// 끝의 잘린 record나 crc가 맞지 않는 record를 만나면 멈춤
+// parameters : rbtree t, char *path, uint32_t ckpt_gen, uint32_t *gen, size_t *logged
+// return : void
+static void replay_log(rbtree *t, const char *path, uint32_t ckpt_gen, uint32_t *gen,
+                       size_t *logged) {
+  size_t len = 0;
+  unsigned char *buf = read_all(path, &len);
+  uint32_t header[2];
+
+  *gen = ckpt_gen + 1;
+  *logged = 0;
+  if(buf == NULL) {
+    return;
+  }
+  if(len >= sizeof(header)) {
+    memcpy(header, buf, sizeof(header));
+  }
+  if(len >= sizeof(header) && header[0] == WAL_MAGIC && header[1] > ckpt_gen) {
+    *gen = header[1];
+    for(size_t off = sizeof(header); off + WAL_RECORD_SIZE <= len; off += WAL_RECORD_SIZE) {
+      key_t key;
+      uint32_t crc;
+      memcpy(&key, buf + off + 1, sizeof(key_t));
+      memcpy(&crc, buf + off + 1 + sizeof(key_t), sizeof(crc));
+      if(crc != crc32(buf + off, 1 + sizeof(key_t))) {
+        break;
+      }
+      if(buf[off] == RBTREE_WAL_INSERT) {
+        rbtree_insert(t, key);
+      } else if(buf[off] == RBTREE_WAL_ERASE) {
+        rbtree_erase(t, rbtree_find(t, key));
+      } else {
+        break;
+      }
+      ++*logged;
+    }
+  }
+  free(buf);
+}
+
+// path를 prefix로 하는 checkpoint와 log에서 rbtree를 복구하고 durable mode로 엶
+// 복구가 끝나면 상태를 새 checkpoint로 기록하여 log를 비움
+// parameters : char *path, int group, size_t checkpoint_every
+// return : rbtree t, 실패 시 NULL
+rbtree *rbtree_open_durable(const char *path, int group, size_t checkpoint_every) {
+  struct rbtree_wal *w = (struct rbtree_wal *)calloc(1, sizeof(struct rbtree_wal));
+  const char *slash = strrchr(path, '/');
+  uint32_t ckpt_gen;
+  rbtree *t;
+
+  if(w == NULL) {
+    return NULL;
+  }
+  w->group = group < 1 ? 1 : group;
+  w->checkpoint_every = checkpoint_every;
+  w->log_path = (char *)malloc(strlen(path) + 5);
+  w->ckpt_path = (char *)malloc(strlen(path) + 6);
+  w->dir_path = slash != NULL ? strndup(path, slash - path + 1) : strdup(".");
+  if(w->log_path == NULL || w->ckpt_path == NULL || w->dir_path == NULL) {
+    free(w->log_path);
+    free(w->ckpt_path);
+    free(w->dir_path);
+    free(w);
+    return NULL;
+  }
+  sprintf(w->log_path, "%s.log", path);
+  sprintf(w->ckpt_path, "%s.ckpt", path);
+
+  t = load_checkpoint(w->ckpt_path, &ckpt_gen);
+  if(t != NULL) {
+    replay_log(t, w->log_path, ckpt_gen, &w->gen, &w->logged);
+    w->fd = open(w->log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  }
+  if(t == NULL || w->fd < 0) {
+    if(t != NULL) {
+      delete_rbtree(t);
+    }
+    free(w->log_path);
+    free(w->ckpt_path);
+    free(w->dir_path);
+    free(w);
+    return NULL;
+  }
+
+  t->wal = w;
+  if(!rbtree_checkpoint(t)) {
+    delete_rbtree(t);
+    return NULL;
+  }
+
+  return t;
+}
@@ -0,0 +1,31 @@
+#ifndef _RBTREE_WAL_H_
+#define _RBTREE_WAL_H_
+
+#include "rbtree.h"
+
+// durable mode: <path>.log holds the write-ahead log and <path>.ckpt the
+// latest sorted snapshot. group is the number of records per fsync and
+// checkpoint_every the log length that triggers a checkpoint (0 = manual).
+rbtree *rbtree_open_durable(const char *path, int group, size_t checkpoint_every);
+int rbtree_checkpoint(rbtree *);
+int rbtree_sync(rbtree *);
+
+// Every change is logged before it is applied. If writing or fsyncing its
+// record fails, the change is not applied: rbtree_insert returns NULL and
+// rbtree_erase 0 with the tree untouched. From then on the tree refuses all
+// changes and rbtree_sync returns 0. Changes applied earlier whose records
+// were not yet synced (group > 1) may be lost; reopen with
+// rbtree_open_durable to get back the last durable state.
+// Each record carries a CRC-32, and replay stops at the first record that
+// does not match, so a torn or garbage tail is never applied.
+
+// called by rbtree.c
+int rbtree_wal_append(rbtree *, const char op, const key_t key);
+void rbtree_wal_applied(rbtree *);
+int rbtree_wal_failed(const struct rbtree_wal *);
+void rbtree_wal_close(struct rbtree_wal *);
+
+#define RBTREE_WAL_INSERT 'I'
+#define RBTREE_WAL_ERASE 'E'
+
+#endif  // _RBTREE_WAL_H_
@@ -1,8 +1,19 @@
 #include <assert.h>
+#include <fcntl.h>
 #include <rbtree.h>
+#include <rbtree_interval.h>
+#include <rbtree_shm.h>
+#include <rbtree_str.h>
+#include <rbtree_td.h>
+#include <rbtree_wal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // new_rbtree should return rbtree struct with null root node
 void test_init(void) {
@@ -367,6 +378,951 @@ void test_find_erase_rand(const size_t n, const unsigned int seed) {
   delete_rbtree(t);
 }
 
+// from_unsorted should build a valid rbtree holding every key in order
+void test_from_unsorted(const size_t n, const int nthreads,
+                        const unsigned int seed) {
+  srand(seed);
+  key_t *arr = calloc(n + 1, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() - RAND_MAX / 2;
+  }
+
+  rbtree *t = rbtree_from_unsorted(arr, n, nthreads);
+  assert(t != NULL);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  qsort((void *)arr, n, sizeof(key_t), comp);
+  key_t *res = calloc(n + 1, sizeof(key_t));
+  rbtree_to_array(t, res, n);
+  for (int i = 0; i < n; i++) {
+    assert(arr[i] == res[i]);
+    assert(rbtree_find(t, arr[i]) != NULL);
+  }
+
+  // the bulk-loaded tree should accept ordinary updates
+  for (int i = 0; i < n; i += 2) {
+    rbtree_erase(t, rbtree_find(t, arr[i]));
+  }
+  rbtree_insert(t, 0);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  // the bulk-load slab is released once its last node is erased
+  while (t->size > 0) {
+    rbtree_erase(t, rbtree_min(t));
+  }
+  for (int i = 0; i < n; i += 2) {
+    rbtree_insert(t, arr[i]);
+  }
+  test_search_constraint(t);
+
+  free(res);
+  free(arr);
+  delete_rbtree(t);
+}
+
+void test_from_unsorted_suite() {
+  test_from_unsorted(0, 4, 3);
+  test_from_unsorted(1, 4, 3);
+  test_from_unsorted(7, 2, 5);
+  test_from_unsorted(10000, 4, 17);
+  test_from_unsorted(10000, 1, 19);
+  test_from_unsorted(1000, 1 << 30, 21);
+}
+
+static void visit_key(node_t *p, size_t idx, void *arg) {
+  key_t *out = (key_t *)arg;
+  out[idx] = p->key;
+}
+
+// parallel export and traversal should match the sequential in-order walk
+void test_parallel_traversal(const size_t n, const int nthreads,
+                             const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  for (int i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+
+  key_t *expected = calloc(n + 1, sizeof(key_t));
+  key_t *res = calloc(n + 1, sizeof(key_t));
+  rbtree_to_array(t, expected, n);
+
+  assert(rbtree_to_array_parallel(t, res, n, nthreads));
+  for (int i = 0; i < n; i++) {
+    assert(expected[i] == res[i]);
+  }
+
+  // a short output array should receive only the first n / 2 keys
+  memset(res, 0, (n + 1) * sizeof(key_t));
+  assert(rbtree_to_array_parallel(t, res, n / 2, nthreads));
+  for (int i = 0; i < n / 2; i++) {
+    assert(expected[i] == res[i]);
+  }
+  for (int i = n / 2; i < n; i++) {
+    assert(res[i] == 0);
+  }
+
+  memset(res, 0, (n + 1) * sizeof(key_t));
+  assert(rbtree_foreach(t, visit_key, res, nthreads));
+  for (int i = 0; i < n; i++) {
+    assert(expected[i] == res[i]);
+  }
+
+  free(res);
+  free(expected);
+  delete_rbtree_parallel(t, nthreads);
+}
+
+void test_parallel_traversal_suite() {
+  test_parallel_traversal(0, 4, 1);
+  test_parallel_traversal(3, 4, 2);
+  test_parallel_traversal(10000, 4, 23);
+  test_parallel_traversal(10000, 1, 29);
+  // absurd thread counts are clamped instead of overflowing the split depth
+  test_parallel_traversal(1000, 1 << 30, 31);
+}
+
+// pop_min/pop_max should drain the tree in sorted order like a priority queue
+void test_pop_minmax(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() % (n / 2 + 1);
+    rbtree_insert(t, arr[i]);
+  }
+  qsort((void *)arr, n, sizeof(key_t), comp);
+
+  key_t key;
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    assert(rbtree_peek_min(t, &key) && key == arr[lo]);
+    assert(rbtree_min(t)->key == arr[lo]);
+    assert(rbtree_max(t)->key == arr[hi - 1]);
+    if ((lo + hi) % 2 == 0) {
+      assert(rbtree_pop_min(t, &key));
+      assert(key == arr[lo++]);
+    } else {
+      assert(rbtree_pop_max(t, &key));
+      assert(key == arr[--hi]);
+    }
+  }
+  assert(!rbtree_peek_min(t, &key));
+  assert(!rbtree_pop_max(t, &key));
+#ifdef SENTINEL
+  assert(rbtree_min(t) == t->nil);
+  assert(rbtree_max(t) == t->nil);
+#endif
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+static void count_overlap(interval_node_t *p, void *arg) {
+  ++*(size_t *)arg;
+}
+
+static key_t check_interval(const interval_rbtree *t, interval_node_t *p) {
+  if (p == t->nil) {
+    return p->max;
+  }
+  key_t m = p->high;
+  key_t l = check_interval(t, p->left);
+  key_t r = check_interval(t, p->right);
+  m = l > m ? l : m;
+  m = r > m ? r : m;
+  assert(p->max == m);
+  return m;
+}
+
+// overlap/stab queries should agree with a brute-force scan
+void test_interval(const size_t n, const unsigned int seed) {
+  srand(seed);
+  interval_rbtree *t = new_rbtree_interval();
+  interval_node_t **nodes = calloc(n, sizeof(interval_node_t *));
+  key_t *lo = calloc(n, sizeof(key_t));
+  key_t *hi = calloc(n, sizeof(key_t));
+  bool *alive = calloc(n, sizeof(bool));
+
+  for (int i = 0; i < n; i++) {
+    lo[i] = rand() % 10000;
+    hi[i] = lo[i] + rand() % 100;
+    nodes[i] = rbtree_interval_insert(t, lo[i], hi[i]);
+    alive[i] = true;
+  }
+  check_interval(t, t->root);
+
+  // reversed endpoints are rejected and leave the tree as it was
+  key_t top = t->root != t->nil ? t->root->max : 0;
+  assert(rbtree_interval_insert(t, 10, 9) == NULL);
+  assert(rbtree_interval_insert(t, 1000000, -1000000) == NULL);
+  assert(t->root == t->nil || t->root->max == top);
+  check_interval(t, t->root);
+
+  for (int round = 0; round < 2; round++) {
+    for (int q = 0; q < 200; q++) {
+      key_t a = rand() % 10100;
+      key_t b = a + rand() % 50;
+      size_t expected = 0, stabbed = 0;
+      for (int i = 0; i < n; i++) {
+        if (alive[i] && lo[i] <= b && a <= hi[i]) {
+          expected++;
+        }
+        if (alive[i] && lo[i] <= a && a <= hi[i]) {
+          stabbed++;
+        }
+      }
+      size_t seen = 0;
+      assert(rbtree_interval_overlap(t, a, b, count_overlap, &seen) ==
+             expected);
+      assert(seen == expected);
+
+      interval_node_t *p = rbtree_interval_stab(t, a);
+      if (stabbed == 0) {
+        assert(p == NULL);
+      } else {
+        assert(p != NULL && p->low <= a && a <= p->high);
+      }
+    }
+
+    for (int i = round; i < n; i += 2) {
+      if (alive[i]) {
+        assert(rbtree_interval_erase(t, nodes[i]));
+        alive[i] = false;
+      }
+    }
+    check_interval(t, t->root);
+  }
+
+  free(alive);
+  free(hi);
+  free(lo);
+  free(nodes);
+  delete_rbtree_interval(t);
+}
+
+static void check_durable(const char *path, const key_t *arr, const size_t n) {
+  rbtree *t = rbtree_open_durable(path, 16, 0);
+  assert(t != NULL);
+  key_t *res = calloc(n + 1, sizeof(key_t));
+  rbtree_to_array(t, res, n);
+  for (int i = 0; i < n; i++) {
+    assert(arr[i] == res[i]);
+  }
+  test_color_constraint(t);
+  free(res);
+  delete_rbtree(t);
+}
+
+// durable tree should recover from checkpoint plus log after a crash
+void test_durable(const size_t n, const unsigned int seed) {
+  char dir[] = "/tmp/rbtree-walXXXXXX";
+  assert(mkdtemp(dir) != NULL);
+  char path[64], file[80];
+  snprintf(path, sizeof(path), "%s/tree", dir);
+
+  srand(seed);
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() % 1000;
+  }
+
+  // child process inserts, commits and dies without closing the tree
+  pid_t pid = fork();
+  if (pid == 0) {
+    rbtree *t = rbtree_open_durable(path, 16, 0);
+    for (int i = 0; i < n; i++) {
+      rbtree_insert(t, arr[i]);
+    }
+    for (int i = 0; i < n; i += 3) {
+      rbtree_erase(t, rbtree_find(t, arr[i]));
+    }
+    rbtree_sync(t);
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  size_t m = 0;
+  key_t *expected = calloc(n, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    if (i % 3 != 0) {
+      expected[m++] = arr[i];
+    }
+  }
+  qsort((void *)expected, m, sizeof(key_t), comp);
+  check_durable(path, expected, m);
+
+  // periodic checkpoints should truncate the log without losing updates
+  rbtree *t = rbtree_open_durable(path, 4, 100);
+  assert(t != NULL);
+  for (int i = 0; i < n; i += 3) {
+    rbtree_insert(t, arr[i]);
+  }
+  delete_rbtree(t);
+  qsort((void *)arr, n, sizeof(key_t), comp);
+  check_durable(path, arr, n);
+
+  snprintf(file, sizeof(file), "%s.log", path);
+  unlink(file);
+  snprintf(file, sizeof(file), "%s.ckpt", path);
+  unlink(file);
+  rmdir(dir);
+  free(expected);
+  free(arr);
+}
+
+// once the log cannot be written the tree should refuse further changes,
+// and reopening should recover exactly the changes that reported success
+void test_durable_failure(void) {
+  char dir[] = "/tmp/rbtree-walXXXXXX";
+  assert(mkdtemp(dir) != NULL);
+  char path[64], file[80];
+  snprintf(path, sizeof(path), "%s/tree", dir);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    rbtree *t = rbtree_open_durable(path, 1, 0);
+    assert(t != NULL);
+    // writes past 200 bytes fail with EFBIG, (200 - 8) / 9 = 21 records of log
+    struct rlimit lim = {200, 200};
+    signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &lim);
+
+    int ok = 0;
+    while (rbtree_insert(t, ok) != NULL) {
+      ok++;
+    }
+    // the insert whose record failed left the tree untouched
+    assert(rbtree_find(t, ok) == NULL && t->size == ok);
+    size_t size = t->size;
+    assert(rbtree_insert(t, -1) == NULL);
+    assert(!rbtree_erase(t, rbtree_find(t, 0)));
+    assert(rbtree_find(t, 0) != NULL && t->size == size);
+    assert(!rbtree_sync(t));
+    _exit(ok);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) > 0);
+  int ok = WEXITSTATUS(status);
+
+  rbtree *t = rbtree_open_durable(path, 1, 0);
+  assert(t != NULL && t->size == ok);
+  for (int i = 0; i < ok; i++) {
+    assert(rbtree_find(t, i) != NULL);
+  }
+  delete_rbtree(t);
+
+  // a garbage tail that looks like an insert record should fail its CRC
+  snprintf(file, sizeof(file), "%s.log", path);
+  FILE *f = fopen(file, "ab");
+  assert(f != NULL);
+  fwrite("I\xe8\x03\x00\x00\x01\x02\x03\x04", 1, 9, f);  // key 1000
+  fclose(f);
+  t = rbtree_open_durable(path, 1, 0);
+  assert(t != NULL && t->size == ok && rbtree_find(t, 1000) == NULL);
+  delete_rbtree(t);
+
+  snprintf(file, sizeof(file), "%s.log", path);
+  unlink(file);
+  snprintf(file, sizeof(file), "%s.ckpt", path);
+  unlink(file);
+  rmdir(dir);
+}
+
+// reader process should see the writer's tree through a read-only mapping,
+// including while the writer keeps updating it
+void test_shm(const char *name, const size_t n, const unsigned int seed) {
+  rbtree_shm_unlink(name);  // left over from an aborted run
+  shm_rbtree *w = rbtree_shm_create(name, n);
+  assert(w != NULL);
+  assert(rbtree_shm_create(name, n) == NULL);  // never truncates a live segment
+
+  srand(seed);
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() % (n * 4);
+    assert(rbtree_shm_insert(w, arr[i]));
+  }
+  assert(!rbtree_shm_insert(w, 0));  // segment is full
+  qsort((void *)arr, n, sizeof(key_t), comp);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    shm_rbtree *r = rbtree_shm_open(name);
+    key_t key;
+    key_t *res = calloc(n, sizeof(key_t));
+    int ok = r != NULL && !rbtree_shm_insert(r, 1);
+    for (int round = 0; ok && round < 200; round++) {
+      // keys [0, 2n) are never touched by the writer below
+      size_t m = rbtree_shm_range(r, 0, n * 2 - 1, res, n);
+      for (int i = 1; i < m; i++) {
+        ok = ok && res[i - 1] <= res[i];
+      }
+      for (int i = 0; ok && i < n && arr[i] < n * 2; i++) {
+        ok = res[i] == arr[i] && rbtree_shm_find(r, arr[i]) == 1;
+      }
+      ok = ok && rbtree_shm_min(r, &key) == 1 && key == arr[0];
+    }
+    free(res);
+    _exit(ok ? 0 : 1);
+  }
+
+  for (int round = 0; round < 200; round++) {
+    for (int i = n - 1; i >= 0 && arr[i] >= n * 2; i--) {
+      assert(rbtree_shm_erase(w, arr[i]));
+    }
+    for (int i = n - 1; i >= 0 && arr[i] >= n * 2; i--) {
+      assert(rbtree_shm_insert(w, arr[i]));
+    }
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  key_t key;
+  key_t *res = calloc(n, sizeof(key_t));
+  assert(rbtree_shm_size(w) == n);
+  assert(rbtree_shm_range(w, arr[0], arr[n - 1], res, n) == n);
+  for (int i = 0; i < n; i++) {
+    assert(res[i] == arr[i]);
+  }
+  assert(rbtree_shm_max(w, &key) && key == arr[n - 1]);
+  assert(!rbtree_shm_find(w, -1));
+
+  free(res);
+  free(arr);
+  rbtree_shm_close(w);
+  assert(rbtree_shm_unlink(name));
+}
+
+// mark the segment at path as mid-update by making its seq word (right after
+// the 4-byte magic) odd, as a writer that stopped inside an update leaves it
+static void shm_stall(const char *path) {
+  uint32_t seq = 1;
+  int fd = open(path, O_RDWR);
+  assert(fd >= 0 && pwrite(fd, &seq, sizeof(seq), 4) == sizeof(seq));
+  close(fd);
+}
+
+// readers should give up instead of spinning forever when the writer died
+// or never finishes an update
+void test_shm_stalled(const char *path) {
+  key_t key, res[4];
+
+  // writer process exits without finishing an update
+  rbtree_shm_unlink(path);
+  pid_t pid = fork();
+  if (pid == 0) {
+    shm_rbtree *w = rbtree_shm_create(path, 16);
+    _exit(w != NULL && rbtree_shm_insert(w, 7) ? 0 : 1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  shm_rbtree *r = rbtree_shm_open(path);
+  assert(r != NULL);
+  assert(rbtree_shm_find(r, 7) == 1);
+  shm_stall(path);
+  assert(rbtree_shm_find(r, 7) == -1);
+  assert(rbtree_shm_min(r, &key) == -1);
+  assert(rbtree_shm_range(r, 0, 10, res, 4) == SIZE_MAX);
+  assert(rbtree_shm_size(r) == SIZE_MAX);
+  rbtree_shm_close(r);
+  assert(rbtree_shm_unlink(path));
+
+  // writer is alive but the update never ends: bounded by the retry limit
+  shm_rbtree *w = rbtree_shm_create(path, 16);
+  assert(w != NULL && rbtree_shm_insert(w, 7));
+  shm_stall(path);
+  assert(rbtree_shm_find(w, 7) == -1);
+  assert(rbtree_shm_max(w, &key) == -1);
+  rbtree_shm_close(w);
+  assert(rbtree_shm_unlink(path));
+}
+
+// compaction should keep the tree intact, including when interleaved with
+// updates between incremental steps
+void test_compact(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand();
+    rbtree_insert(t, arr[i]);
+  }
+  for (int i = 0; i < n; i += 2) {
+    rbtree_erase(t, rbtree_find(t, arr[i]));
+  }
+
+  rbtree_compact(t);
+  test_color_constraint(t);
+  test_search_constraint(t);
+  for (int i = 1; i < n; i += 2) {
+    assert(rbtree_find(t, arr[i]) != NULL);
+  }
+
+  // incremental steps with churn in between
+  int done = 0;
+  for (int i = 0; i < n; i += 2) {
+    if (!done) {
+      done = rbtree_compact_step(t, 16);
+    }
+    rbtree_insert(t, arr[i]);
+    if (i % 4 == 0) {
+      rbtree_erase(t, rbtree_find(t, arr[i]));
+    }
+  }
+  while (!rbtree_compact_step(t, 16)) {
+  }
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  key_t *expected = calloc(n, sizeof(key_t));
+  size_t m = 0;
+  for (int i = 0; i < n; i++) {
+    if (i % 4 != 0) {
+      expected[m++] = arr[i];
+    }
+  }
+  qsort((void *)expected, m, sizeof(key_t), comp);
+  key_t *res = calloc(n, sizeof(key_t));
+  rbtree_to_array(t, res, m);
+  for (int i = 0; i < m; i++) {
+    assert(expected[i] == res[i]);
+  }
+  assert(rbtree_min(t)->key == expected[0]);
+  assert(rbtree_max(t)->key == expected[m - 1]);
+
+  // compaction reuses its slab slots for later inserts
+  for (int i = 0; i < n; i++) {
+    rbtree_erase(t, rbtree_min(t));
+    rbtree_insert(t, arr[i]);
+  }
+  test_color_constraint(t);
+
+  // emptying the newest slab releases it, later inserts fall back to malloc
+  while (t->size > 0) {
+    rbtree_erase(t, rbtree_min(t));
+  }
+  assert(t->size == 0 && t->root == t->nil);
+  for (int i = 0; i < n; i++) {
+    rbtree_insert(t, arr[i]);
+  }
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  // a compaction whose tree is emptied midway drops its target slab
+  assert(!rbtree_compact_step(t, 16));
+  while (t->size > 0) {
+    rbtree_erase(t, rbtree_min(t));
+  }
+  assert(rbtree_compact_step(t, 16));
+  rbtree_insert(t, arr[0]);
+  assert(rbtree_find(t, arr[0]) != NULL);
+
+  // a reserved slab serves inserts past its capacity, then malloc takes over
+  assert(!rbtree_reserve(t, 0));
+  assert(rbtree_reserve(t, n / 2));
+  for (int i = 1; i < n; i++) {
+    rbtree_insert(t, arr[i]);
+  }
+  test_color_constraint(t);
+  test_search_constraint(t);
+  for (int i = 0; i < n; i++) {
+    assert(rbtree_find(t, arr[i]) != NULL);
+  }
+
+  free(res);
+  free(expected);
+  free(arr);
+  delete_rbtree(t);
+}
+
+// relaxed mode should keep the search order at all times and satisfy the
+// color constraint again once the deferred work is done
+void test_relaxed(const size_t n, const size_t budget, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *arr = calloc(n, sizeof(key_t));
+  rbtree_set_relaxed(t, 1, budget);
+
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() % n;
+    rbtree_insert(t, arr[i]);
+  }
+  test_search_constraint(t);
+  for (int i = 0; i < n; i++) {
+    assert(rbtree_find(t, arr[i]) != NULL);
+  }
+
+  while (rbtree_rebalance(t, 10) > 0) {
+    test_search_constraint(t);
+  }
+  test_color_constraint(t);
+
+  // erases interleaved with deferred inserts
+  for (int i = 0; i < n; i += 2) {
+    rbtree_erase(t, rbtree_find(t, arr[i]));
+    rbtree_insert(t, arr[i] + 1);
+  }
+  rbtree_set_relaxed(t, 0, 0);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+static int tree_height(const rbtree *t, const node_t *p) {
+  if (p == t->nil) {
+    return 0;
+  }
+  int l = tree_height(t, p->left);
+  int r = tree_height(t, p->right);
+  return 1 + (l > r ? l : r);
+}
+
+// ascending keys (timestamps) should not build up a backlog or a tall tree:
+// with a budget every insert retires what it records, and even without one
+// at most two reds are in a row, so height stays within 3 log2(n + 1) + 2
+void test_relaxed_monotonic(const size_t n, const size_t budget) {
+  rbtree *t = new_rbtree();
+  rbtree_set_relaxed(t, 1, budget);
+
+  int lg = 0;
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, i);
+    if (((i + 1) & i) == 0) {
+      lg++;  // lg == floor(log2(i + 1)) + 1 >= log2(i + 2)
+    }
+    if (budget > 0) {
+      // the budget keeps up: the backlog stays within a few records per level
+      assert(rbtree_rebalance(t, 0) <= (size_t)lg);
+    }
+    if (i % 1024 == 0) {
+      assert(tree_height(t, t->root) <= 3 * lg + 2);
+    }
+  }
+  assert(tree_height(t, t->root) <= 3 * lg + 2);
+  if (budget == 0) {
+    // an erase only settles the deferred work on its own path
+    size_t backlog = rbtree_rebalance(t, 0);
+    assert(rbtree_erase(t, rbtree_min(t)));
+    assert(rbtree_rebalance(t, 0) > backlog / 2);
+  }
+  rbtree_rebalance(t, SIZE_MAX);
+  assert(rbtree_rebalance(t, 0) == 0);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  delete_rbtree(t);
+}
+
+// trees crossing the 16-key small-set threshold in both directions should keep
+// find/min/max and the rb constraints intact, and find should keep returning
+// the nodes insert handed out
+void test_small_tree(const unsigned int seed) {
+  const size_t n = 48;
+  srand(seed);
+  rbtree *t = new_rbtree();
+  rbtree *u = new_rbtree();
+  assert(t->nil == u->nil);
+
+  key_t arr[48];
+  node_t *nodes[48];
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < n; i++) {
+      arr[i] = rand() % 20;
+      nodes[i] = rbtree_insert(t, arr[i]);
+      for (int j = 0; j <= i; j++) {
+        node_t *p = rbtree_find(t, arr[j]);
+        assert(p != NULL && p->key == arr[j]);
+      }
+      assert(rbtree_find(t, 20) == NULL);
+      test_color_constraint(t);
+    }
+    for (int i = n - 1; i >= 0; i--) {
+      assert(rbtree_erase(t, nodes[i]));
+      for (int j = 0; j < i; j++) {
+        node_t *p = rbtree_find(t, arr[j]);
+        assert(p != NULL && p->key == arr[j]);
+        int k = 0;
+        while (k < i && nodes[k] != p) {
+          k++;
+        }
+        assert(k < i);
+      }
+      test_color_constraint(t);
+      test_search_constraint(t);
+    }
+#ifdef SENTINEL
+    assert(t->root == t->nil);
+#endif
+    assert(rbtree_find(t, arr[0]) == NULL);
+  }
+
+  delete_rbtree(u);
+  delete_rbtree(t);
+}
+
+typedef struct {
+  char buf[24];
+  size_t len;
+} str_key;
+
+static int str_comp(const void *p1, const void *p2) {
+  const str_key *a = (const str_key *)p1;
+  const str_key *b = (const str_key *)p2;
+  int c = memcmp(a->buf, b->buf, a->len < b->len ? a->len : b->len);
+  return c != 0 ? c : (a->len > b->len) - (a->len < b->len);
+}
+
+// string keys sharing long prefixes should still sort bytewise
+void test_str_tree(const size_t n, const unsigned int seed) {
+  srand(seed);
+  str_rbtree *t = new_rbtree_str();
+  str_key *keys = calloc(n, sizeof(str_key));
+  for (int i = 0; i < n; i++) {
+    // short keys, keys differing only past the 8-byte prefix, embedded NULs
+    switch (i % 3) {
+    case 0:
+      keys[i].len = snprintf(keys[i].buf, sizeof(keys[i].buf), "%d", rand() % 100);
+      break;
+    case 1:
+      keys[i].len = snprintf(keys[i].buf, sizeof(keys[i].buf), "user:000%05d", rand() % 1000);
+      break;
+    default:
+      keys[i].len = rand() % 12;
+      for (int j = 0; j < keys[i].len; j++) {
+        keys[i].buf[j] = rand() % 3;
+      }
+    }
+    assert(rbtree_str_insert(t, keys[i].buf, keys[i].len) != NULL);
+  }
+  qsort(keys, n, sizeof(str_key), str_comp);
+
+  str_node_t *p = rbtree_str_first(t);
+  for (int i = 0; i < n; i++, p = rbtree_str_next(t, p)) {
+    assert(p != NULL);
+    assert(p->len == keys[i].len && memcmp(p->key, keys[i].buf, p->len) == 0);
+    str_node_t *q = rbtree_str_find(t, keys[i].buf, keys[i].len);
+    assert(q != NULL);
+    assert(q->len == keys[i].len && memcmp(q->key, keys[i].buf, q->len) == 0);
+  }
+  assert(p == NULL);
+  assert(rbtree_str_find(t, "user:0000", 9) == NULL);
+
+  p = rbtree_str_lower_bound(t, "user:000", 8);
+  assert(p != NULL && p->len > 8 && memcmp(p->key, "user:000", 8) == 0);
+  assert(rbtree_str_lower_bound(t, "zzz", 3) == NULL);
+
+  for (int i = 0; i < n; i += 2) {
+    assert(rbtree_str_erase(t, rbtree_str_find(t, keys[i].buf, keys[i].len)));
+  }
+  size_t m = 0;
+  for (p = rbtree_str_first(t); p != NULL; p = rbtree_str_next(t, p)) {
+    str_node_t *q = rbtree_str_next(t, p);
+    if (q != NULL) {
+      str_key a = {"", p->len}, b = {"", q->len};
+      memcpy(a.buf, p->key, p->len);
+      memcpy(b.buf, q->key, q->len);
+      assert(str_comp(&a, &b) <= 0);
+    }
+    m++;
+  }
+  assert(m == n / 2);
+
+  free(keys);
+  delete_rbtree_str(t);
+}
+
+// erasing keys should give their arena bytes back instead of growing forever,
+// and the surviving keys should stay intact when they are moved
+void test_str_arena_reuse(void) {
+  str_rbtree *t = new_rbtree_str();
+  char buf[1000];
+
+  // too long for the 32-bit length field, rejected before the key is read
+  assert(rbtree_str_insert(t, buf, (size_t)UINT32_MAX + 1) == NULL);
+  assert(t->live == 0 && t->root == t->nil);
+
+  for (int i = 0; i < 10000; i++) {
+    memset(buf, 'a' + i % 26, sizeof(buf));
+    buf[0] = (char)(i / 26);
+    assert(rbtree_str_insert(t, buf, sizeof(buf)) != NULL);
+    if (i >= 10) {
+      // keep the 10 most recent keys
+      memset(buf, 'a' + (i - 10) % 26, sizeof(buf));
+      buf[0] = (char)((i - 10) / 26);
+      assert(rbtree_str_erase(t, rbtree_str_find(t, buf, sizeof(buf))));
+    }
+    assert(t->live <= 11 * sizeof(buf));
+    assert(t->dead < 64 * 1024 || t->dead <= t->live);
+  }
+  for (int i = 9990; i < 10000; i++) {
+    memset(buf, 'a' + i % 26, sizeof(buf));
+    buf[0] = (char)(i / 26);
+    str_node_t *p = rbtree_str_find(t, buf, sizeof(buf));
+    assert(p != NULL && memcmp(p->key, buf, sizeof(buf)) == 0);
+  }
+
+  delete_rbtree_str(t);
+}
+
+// black height of the subtree, asserting no red node has a red child
+static int check_td(const td_node_t *p, const color_t parent_color) {
+  if (p == NULL) {
+    return 1;
+  }
+  assert(!(parent_color == RBTREE_RED && p->color == RBTREE_RED));
+  int l = check_td(p->link[0], p->color);
+  int r = check_td(p->link[1], p->color);
+  assert(l == r);
+  return l + (p->color == RBTREE_BLACK);
+}
+
+// top-down variant should keep the same keys in order as the core tree
+void test_td_tree(const size_t n, const unsigned int seed) {
+  srand(seed);
+  td_rbtree *t = new_rbtree_td();
+  key_t *arr = calloc(n, sizeof(key_t));
+  td_iter it;
+  assert(rbtree_td_first(t, &it) == NULL);
+  assert(!rbtree_td_erase(t, 0));
+  for (int i = 0; i < n; i++) {
+    arr[i] = rand() % (n / 2);
+    assert(rbtree_td_insert(t, arr[i]) != NULL);
+  }
+  assert(t->size == n);
+  check_td(t->root, RBTREE_BLACK);
+
+  qsort(arr, n, sizeof(key_t), comp);
+  td_node_t *p = rbtree_td_first(t, &it);
+  for (int i = 0; i < n; i++, p = rbtree_td_next(&it)) {
+    assert(p != NULL && p->key == arr[i]);
+    assert(rbtree_td_find(t, arr[i]) != NULL);
+  }
+  assert(p == NULL);
+  assert(rbtree_td_find(t, -1) == NULL);
+
+  // erase every other key, duplicates included
+  for (int i = 0; i < n; i += 2) {
+    assert(rbtree_td_erase(t, arr[i]));
+    if (i % 256 == 0) {
+      check_td(t->root, RBTREE_BLACK);
+    }
+  }
+  assert(t->size == n - (n + 1) / 2);
+  check_td(t->root, RBTREE_BLACK);
+  p = rbtree_td_first(t, &it);
+  for (int i = 1; i < n; i += 2, p = rbtree_td_next(&it)) {
+    assert(p != NULL && p->key == arr[i]);
+  }
+  assert(p == NULL);
+
+  for (int i = 1; i < n; i += 2) {
+    assert(rbtree_td_erase(t, arr[i]));
+  }
+  assert(t->root == NULL && t->size == 0);
+  assert(!rbtree_td_erase(t, arr[0]));
+
+  // a reserved chunk is used before the tree grows its own
+  assert(!rbtree_td_reserve(t, 0));
+  assert(rbtree_td_reserve(t, n) && t->cap == n);
+  for (int i = 0; i < n; i++) {
+    assert(rbtree_td_insert(t, arr[i]) != NULL);
+  }
+  assert(t->cap == n);
+  check_td(t->root, RBTREE_BLACK);
+
+  free(arr);
+  delete_rbtree_td(t);
+}
+
+// bounded trees should hold the largest, smallest or latest cap keys
+void test_bounded(const size_t n, const size_t cap, const unsigned int seed) {
+  srand(seed);
+  key_t *stream = calloc(n, sizeof(key_t));
+  key_t *expected = calloc(n, sizeof(key_t));
+  key_t *res = calloc(cap, sizeof(key_t));
+  for (int i = 0; i < n; i++) {
+    stream[i] = rand() % (n / 4);
+  }
+  assert(new_rbtree_bounded(0, RBTREE_EVICT_MIN) == NULL);
+
+  for (evict_t policy = RBTREE_EVICT_MIN; policy <= RBTREE_EVICT_OLDEST; policy++) {
+    rbtree *t = new_rbtree_bounded(cap, policy);
+    for (int i = 0; i < n; i++) {
+      node_t *victim = policy == RBTREE_EVICT_MIN ? t->leftmost : t->rightmost;
+      key_t edge = victim->key;
+      node_t *p = rbtree_insert(t, stream[i]);
+      if (i >= cap && policy == RBTREE_EVICT_MIN) {
+        // rejected when it would be evicted at once, otherwise reuses the min node
+        assert(p == (stream[i] <= edge ? NULL : victim));
+      } else if (i >= cap && policy == RBTREE_EVICT_MAX) {
+        assert(p == (stream[i] >= edge ? NULL : victim));
+      } else {
+        assert(p != NULL && p->key == stream[i]);
+      }
+      assert(t->size == (i < cap ? i + 1 : cap));
+    }
+    test_color_constraint(t);
+    test_search_constraint(t);
+
+    memcpy(expected, stream, n * sizeof(key_t));
+    if (policy == RBTREE_EVICT_OLDEST) {
+      qsort(expected + n - cap, cap, sizeof(key_t), comp);
+    } else {
+      qsort(expected, n, sizeof(key_t), comp);
+    }
+    key_t *want = policy == RBTREE_EVICT_MAX ? expected : expected + n - cap;
+    rbtree_to_array(t, res, cap);
+    for (int i = 0; i < cap; i++) {
+      assert(res[i] == want[i]);
+    }
+    delete_rbtree(t);
+  }
+
+  // erasing from a sliding window drops the key from the insertion order too
+  rbtree *t = new_rbtree_bounded(cap, RBTREE_EVICT_OLDEST);
+  size_t lo = 0, hi = 0;  // window is expected[lo..hi), oldest first
+  for (int i = 0; i < n; i++) {
+    if (i % 7 == 3 && hi > lo) {
+      key_t key = expected[lo + rand() % (hi - lo)];
+      assert(rbtree_erase(t, rbtree_find(t, key)));
+      size_t j = lo;
+      while (expected[j] != key) {
+        j++;
+      }
+      memmove(&expected[j], &expected[j + 1], (hi - j - 1) * sizeof(key_t));
+      hi--;
+    }
+    if (hi - lo == cap) {
+      lo++;
+    }
+    expected[hi++] = stream[i];
+    assert(rbtree_insert(t, stream[i]) != NULL);
+    assert(t->size == hi - lo);
+  }
+  test_color_constraint(t);
+  qsort(expected + lo, hi - lo, sizeof(key_t), comp);
+  rbtree_to_array(t, res, hi - lo);
+  for (int i = 0; i < hi - lo; i++) {
+    assert(res[i] == expected[lo + i]);
+  }
+  delete_rbtree(t);
+
+  free(res);
+  free(expected);
+  free(stream);
+}
+
 int main(void) {
   test_init();
   test_insert_single(1024);
@@ -379,5 +1335,25 @@ int main(void) {
   test_duplicate_values();
   test_multi_instance();
   test_find_erase_rand(10000, 17);
+  test_from_unsorted_suite();
+  test_parallel_traversal_suite();
+  test_pop_minmax(1000, 31);
+  test_interval(2000, 37);
+  test_durable(1000, 41);
+  test_durable_failure();
+  test_compact(5000, 53);
+  test_relaxed(5000, 0, 59);
+  test_relaxed(5000, 1, 61);
+  test_relaxed_monotonic(100000, 1);
+  test_relaxed_monotonic(100000, 0);
+  test_small_tree(67);
+  test_str_tree(3000, 71);
+  test_str_arena_reuse();
+  test_td_tree(5000, 73);
+  test_bounded(5000, 100, 79);
+  test_bounded(2000, 5, 83);
+  test_shm("/tmp/rbtree-shm-test", 1000, 43);
+  test_shm("/rbtree-shm-test", 1000, 47);
+  test_shm_stalled("/tmp/rbtree-shm-stall-test");
   printf("Passed all tests!\n");
 }